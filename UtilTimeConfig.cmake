@@ -1,4 +1,5 @@
 # Pull in any dependencies we may need...
 include(CMakeFindDependencyMacro)
+find_dependency(Threads)
 # Bootstrap our config
 include("${CMAKE_CURRENT_LIST_DIR}/UtilTimeTargets.cmake")
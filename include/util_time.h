@@ -7,8 +7,49 @@
 #include <sys/time.h>
 #include <string>
 
+/**
+ * Header-only mode
+ * ----------------
+ * Defining NSTIMESTAMP_HEADER_ONLY (the TimeHeaderOnly CMake target does
+ * this for you) pulls the hot-path definitions (capture, copy, diffs and
+ * epoch conversions) into this header as inline functions, allowing them to
+ * be folded into the caller's loops.
+ *
+ * The heavier parse / format paths remain compiled, and are only required
+ * (via the TimeFormat target) if they are used.
+ */
+#ifdef NSTIMESTAMP_HEADER_ONLY
+#define NSTIMESTAMP_INLINE inline
+#else
+#define NSTIMESTAMP_INLINE
+#endif
+
 namespace nstimestamp {
 
+/*
+ * Epoch nano-second arithmetic, shared by the inline and compiled paths
+ */
+namespace time_detail {
+    const long NS_PER_SEC = 1000000000L;
+
+    // Round towards -infinity (pre-1970 values are negative)
+    inline long FloorDiv(long value, long divisor) {
+        long result = value / divisor;
+        if (value % divisor < 0) {
+            --result;
+        }
+        return result;
+    }
+
+    // Split nano-seconds since the epoch, with tv_nsec in [0, 1e9)
+    inline timespec ToTimespec(long ns) {
+        timespec ts;
+        ts.tv_sec = FloorDiv(ns, NS_PER_SEC);
+        ts.tv_nsec = ns - ts.tv_sec * NS_PER_SEC;
+        return ts;
+    }
+}
+
 class Time {
 public:
     // Initialise with the current time
@@ -32,12 +73,20 @@ public:
      */
     Time (const struct timeval& tv);
 
+    /**
+     * Initialise from a system timespec object
+     */
+    Time (const struct timespec& tv);
+
+    // Initialise from nano-seconds since the epoch
+    static Time FromEpochNSecs(long epochNs);
 
     // Assignment operators, behave as c'tors...
     Time& operator=(const Time& rhs);
     Time& operator=(const std::string& timestamp);
     Time& operator=(const char* timestamp);
     Time& operator=(const struct timeval& tv);
+    Time& operator=(const struct timespec& tv);
 
     // Reset the time object to the current time
     Time& SetNow();
@@ -52,16 +101,26 @@ public:
     int Hour()   const { MakeReady(); return data.tm_hour;}
     int Minute() const { MakeReady(); return data.tm_min;}
     int Second() const { MakeReady(); return data.tm_sec;}
-    int MSec()   const { return ts.tv_nsec / 1000000;}
-    int USec()   const { return ts.tv_nsec / 1000;}
-    int NSec()   const { return ts.tv_nsec;}
+    int MSec()   const { return NSec() / 1000000;}
+    int USec()   const { return NSec() / 1000;}
+    int NSec()   const { return IsLeapSecond() ? ts.tv_nsec - 1000000000L : ts.tv_nsec;}
+
+    /**
+     * True during an inserted leap second (23:59:60). This is held as an
+     * additional second of nano-seconds on top of 23:59:59, so that the
+     * POSIX epoch values match those of the following second.
+     *
+     * Leap seconds are not validated: see LeapSeconds (util_time_leap.h)
+     */
+    bool IsLeapSecond() const { return ts.tv_nsec >= 1000000000L;}
 
-    // Diffs: Time since rhs: (this - rhs)
+    // Diffs: Time since rhs: (this - rhs). Leap seconds are ignored: see
+    // LeapSeconds for the elapsed SI time
     int  DiffSecs (const Time& rhs) const;
     long DiffUSecs (const Time& rhs) const;
     long DiffNSecs (const Time& rhs) const;
 
-    // micro-seconds since the epoch
+    // Time since the epoch. A leap second reads as the following second
     int EpochSecs() const;
     long EpochUSecs() const;
     long EpochNSecs() const;
@@ -125,4 +184,8 @@ private:
 };
 }
 
+#ifdef NSTIMESTAMP_HEADER_ONLY
+#include "util_time_inl.h"
+#endif
+
 #endif
@@ -0,0 +1,374 @@
+/**
+ * (c) Luke Humphreys 2017
+ *
+ * Compile time specialised timestamp formats.
+ *
+ * A strftime-like format specification is parsed by the compiler into a
+ * fixed-length writer and a matching parser. No format interpretation is done
+ * at run-time: each field is written / read at an offset known statically.
+ *
+ * Supported conversions:
+ *     %Y    4 digit year
+ *     %m    2 digit month      [01-12]
+ *     %d    2 digit day        [01-31]
+ *     %H    2 digit hour       [00-23]
+ *     %M    2 digit minute     [00-59]
+ *     %S    2 digit second     [00-60]
+ *     %3N   milli-seconds      (3 digits)
+ *     %6N   micro-seconds      (6 digits)
+ *     %9N   nano-seconds       (9 digits)
+ *     %%    A literal '%'
+ * Any other character is copied verbatim.
+ *
+ * Usage:
+ *     constexpr char CSVSpec[] = "%Y-%m-%d %H:%M:%S.%3N";
+ *     using CSVFormat = StaticFormat<CSVSpec>;
+ *
+ *     std::string stamp = CSVFormat::Format(Time());
+ *
+ *     Time parsed;
+ *     CSVFormat::Parse(stamp, parsed);
+ *
+ * NOTE: The specification must be a constexpr char array with static storage
+ *       duration so that it may be used as a template argument.
+ */
+#ifndef __ELF_64_UTIL_TIME_FORMAT__
+#define __ELF_64_UTIL_TIME_FORMAT__
+
+#include "util_time.h"
+#include <cstddef>
+#include <string>
+
+namespace nstimestamp {
+
+namespace format_detail {
+    enum FieldKind {
+        LITERAL,
+        YEAR,
+        MONTH,
+        MDAY,
+        HOUR,
+        MINUTE,
+        SECOND,
+        MSEC,
+        USEC,
+        NSEC,
+        INVALID
+    };
+
+    /**
+     * Broken down time, as read from / written to a formatted string.
+     *
+     * Fields not present in the format retain their Epoch defaults.
+     */
+    struct Parts {
+        unsigned year = 1970;
+        unsigned month = 1;
+        unsigned mday = 1;
+        unsigned hour = 0;
+        unsigned minute = 0;
+        unsigned second = 0;
+        unsigned nsec = 0;
+    };
+
+    /*
+     * Compile time specification parsing
+     * ----------------------------------
+     *  The spec is split into "fields": either a single literal character or a
+     *  single % conversion. (C++11 constexpr: recursion only)
+     */
+
+    // The number of spec characters consumed by the field starting at f
+    constexpr size_t SpecLength(const char* f) {
+        return f[0] != '%'    ? 1 :
+               f[1] == '\0'   ? 1 :
+               (f[1] >= '1' && f[1] <= '9' && f[2] != '\0') ? 3 : 2;
+    }
+
+    constexpr FieldKind Kind(const char* f) {
+        return f[0] != '%'                 ? LITERAL :
+               f[1] == '%'                 ? LITERAL :
+               f[1] == 'Y'                 ? YEAR :
+               f[1] == 'm'                 ? MONTH :
+               f[1] == 'd'                 ? MDAY :
+               f[1] == 'H'                 ? HOUR :
+               f[1] == 'M'                 ? MINUTE :
+               f[1] == 'S'                 ? SECOND :
+               (f[1] == '3' && f[2] == 'N') ? MSEC :
+               (f[1] == '6' && f[2] == 'N') ? USEC :
+               (f[1] == '9' && f[2] == 'N') ? NSEC :
+                                             INVALID;
+    }
+
+    constexpr char Literal(const char* f) {
+        return f[0] == '%' ? '%' : f[0];
+    }
+
+    constexpr size_t Width(FieldKind kind) {
+        return kind == LITERAL ? 1 :
+               kind == YEAR    ? 4 :
+               kind == MSEC    ? 3 :
+               kind == USEC    ? 6 :
+               kind == NSEC    ? 9 :
+               kind == INVALID ? 0 :
+                                 2;
+    }
+
+    // Valid range of each field's digits, as documented above
+    constexpr unsigned MinValue(FieldKind kind) {
+        return (kind == MONTH || kind == MDAY) ? 1 : 0;
+    }
+
+    constexpr unsigned MaxValue(FieldKind kind) {
+        return kind == MONTH  ? 12 :
+               kind == MDAY   ? 31 :
+               kind == HOUR   ? 23 :
+               kind == MINUTE ? 59 :
+               kind == SECOND ? 60 :
+                                ~0u;
+    }
+
+    constexpr size_t FieldCount(const char* spec) {
+        return *spec == '\0' ? 0 : 1 + FieldCount(spec + SpecLength(spec));
+    }
+
+    constexpr const char* FieldSpec(const char* spec, size_t i) {
+        return i == 0 ? spec : FieldSpec(spec + SpecLength(spec), i - 1);
+    }
+
+    constexpr size_t FieldOffset(const char* spec, size_t i) {
+        return i == 0 ? 0 : Width(Kind(spec)) +
+                            FieldOffset(spec + SpecLength(spec), i - 1);
+    }
+
+    constexpr size_t FormattedLength(const char* spec) {
+        return FieldOffset(spec, FieldCount(spec));
+    }
+
+    constexpr bool IsValid(const char* spec) {
+        return *spec == '\0' ? true :
+               Kind(spec) == INVALID ? false :
+               IsValid(spec + SpecLength(spec));
+    }
+
+    /*
+     * Fixed width digit handling
+     * --------------------------
+     */
+    template <size_t W>
+    struct Digits {
+        static void Write(char* out, unsigned value) {
+            out[W - 1] = static_cast<char>('0' + value % 10);
+            Digits<W - 1>::Write(out, value / 10);
+        }
+
+        static bool Read(const char* in, unsigned& value) {
+            unsigned digit = static_cast<unsigned char>(in[W - 1]) - '0';
+            unsigned head = 0;
+            const bool ok = Digits<W - 1>::Read(in, head);
+            value = head * 10 + digit;
+            return ok && digit <= 9;
+        }
+    };
+
+    template <>
+    struct Digits<0> {
+        static void Write(char*, unsigned) { }
+        static bool Read(const char*, unsigned& value) {
+            value = 0;
+            return true;
+        }
+    };
+
+    /*
+     * Field handlers: one specialisation per conversion
+     * -------------------------------------------------
+     */
+    template <FieldKind K, size_t Offset, char L>
+    struct Field;
+
+    template <size_t Offset, char L>
+    struct Field<LITERAL, Offset, L> {
+        static void Write(char* out, const Parts&) {
+            out[Offset] = L;
+        }
+        static bool Read(const char* in, Parts&) {
+            return in[Offset] == L;
+        }
+    };
+
+#define NSTIMESTAMP_FORMAT_FIELD(KIND, MEMBER, SCALE)                        \
+    template <size_t Offset, char L>                                         \
+    struct Field<KIND, Offset, L> {                                          \
+        static void Write(char* out, const Parts& parts) {                   \
+            Digits<Width(KIND)>::Write(out + Offset, parts.MEMBER / SCALE);  \
+        }                                                                    \
+        static bool Read(const char* in, Parts& parts) {                     \
+            unsigned value = 0;                                              \
+            const bool ok = Digits<Width(KIND)>::Read(in + Offset, value);   \
+            parts.MEMBER = value * SCALE;                                    \
+            return ok && value >= MinValue(KIND) && value <= MaxValue(KIND); \
+        }                                                                    \
+    };
+
+    NSTIMESTAMP_FORMAT_FIELD(YEAR,   year,   1)
+    NSTIMESTAMP_FORMAT_FIELD(MONTH,  month,  1)
+    NSTIMESTAMP_FORMAT_FIELD(MDAY,   mday,   1)
+    NSTIMESTAMP_FORMAT_FIELD(HOUR,   hour,   1)
+    NSTIMESTAMP_FORMAT_FIELD(MINUTE, minute, 1)
+    NSTIMESTAMP_FORMAT_FIELD(SECOND, second, 1)
+    NSTIMESTAMP_FORMAT_FIELD(MSEC,   nsec,   1000000)
+    NSTIMESTAMP_FORMAT_FIELD(USEC,   nsec,   1000)
+    NSTIMESTAMP_FORMAT_FIELD(NSEC,   nsec,   1)
+
+#undef NSTIMESTAMP_FORMAT_FIELD
+
+    template <const char* Spec, size_t I>
+    struct FieldAt {
+        typedef Field<Kind(FieldSpec(Spec, I)),
+                      FieldOffset(Spec, I),
+                      Literal(FieldSpec(Spec, I))> type;
+    };
+
+    /*
+     * Index sequence (std::index_sequence is C++14)
+     */
+    template <size_t... I>
+    struct Indices { };
+
+    template <size_t N, size_t... I>
+    struct MakeIndices: MakeIndices<N - 1, N - 1, I...> { };
+
+    template <size_t... I>
+    struct MakeIndices<0, I...> {
+        typedef Indices<I...> type;
+    };
+
+    /**
+     * Days since the Epoch of the provided civil date (proleptic Gregorian)
+     */
+    inline long DaysFromCivil(long y, unsigned m, unsigned d) {
+        y -= m <= 2;
+        const long era = (y >= 0 ? y : y - 399) / 400;
+        const unsigned yoe = static_cast<unsigned>(y - era * 400);
+        const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+        const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return era * 146097 + static_cast<long>(doe) - 719468;
+    }
+
+    /**
+     * The civil date (proleptic Gregorian) of days since the Epoch: the
+     * inverse of DaysFromCivil
+     */
+    inline void CivilFromDays(long days, long& y, unsigned& m, unsigned& d) {
+        days += 719468;
+        const long era = (days >= 0 ? days : days - 146096) / 146097;
+        const unsigned doe = static_cast<unsigned>(days - era * 146097);
+        const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        const unsigned mp = (5 * doy + 2) / 153;
+        d = doy - (153 * mp + 2) / 5 + 1;
+        m = mp < 10 ? mp + 3 : mp - 9;
+        y = static_cast<long>(yoe) + era * 400 + (m <= 2);
+    }
+}
+
+template <const char* Spec>
+class StaticFormat {
+public:
+    static_assert(format_detail::IsValid(Spec),
+                  "Unsupported conversion in StaticFormat specification");
+
+    // Number of characters produced by Write()
+    static constexpr size_t Length = format_detail::FormattedLength(Spec);
+
+    /**
+     * Write exactly Length characters to buf. No null terminator is written.
+     */
+    static void Write(const Time& time, char* buf) {
+        format_detail::Parts parts;
+        parts.year = time.Year();
+        parts.month = time.Month();
+        parts.mday = time.MDay();
+        parts.hour = time.Hour();
+        parts.minute = time.Minute();
+        parts.second = time.Second();
+        parts.nsec = time.NSec();
+        Write(parts, buf, FieldIndices());
+    }
+
+    static std::string Format(const Time& time) {
+        char buf[Length + 1];
+        Write(time, buf);
+        return std::string(buf, Length);
+    }
+
+    /**
+     * Parse the first Length characters of str.
+     *
+     * Returns false, leaving time untouched, if str is too short, does not
+     * match the specification, or has a field outside its documented range.
+     * (Day of month is checked against [01-31], not the month's length)
+     * Trailing characters are ignored.
+     */
+    static bool Parse(const char* str, size_t len, Time& time) {
+        format_detail::Parts parts;
+        if (len < Length || !Read(str, parts, FieldIndices())) {
+            return false;
+        }
+
+        const long days = format_detail::DaysFromCivil(
+                              parts.year, parts.month, parts.mday);
+        timespec ts;
+        ts.tv_sec = days * 86400 +
+                    parts.hour * 3600 + parts.minute * 60 + parts.second;
+        ts.tv_nsec = parts.nsec;
+        if (parts.second == 60 && parts.hour == 23 && parts.minute == 59) {
+            // Leap second: 23:59:59, plus an extra second of nano-seconds.
+            // Any other :60 is normalised into the following minute
+            ts.tv_sec -= 1;
+            ts.tv_nsec += 1000000000L;
+        }
+        time = ts;
+        return true;
+    }
+
+    static bool Parse(const std::string& str, Time& time) {
+        return Parse(str.c_str(), str.length(), time);
+    }
+
+private:
+    typedef typename format_detail::MakeIndices<
+                format_detail::FieldCount(Spec)>::type FieldIndices;
+
+    template <size_t... I>
+    static void Write(const format_detail::Parts& parts,
+                      char* buf,
+                      format_detail::Indices<I...>)
+    {
+        int expand[] = {
+            0, (format_detail::FieldAt<Spec, I>::type::Write(buf, parts), 0)...
+        };
+        (void)expand;
+    }
+
+    template <size_t... I>
+    static bool Read(const char* str,
+                     format_detail::Parts& parts,
+                     format_detail::Indices<I...>)
+    {
+        bool ok = true;
+        int expand[] = {
+            0, (ok = format_detail::FieldAt<Spec, I>::type::Read(str, parts) && ok, 0)...
+        };
+        (void)expand;
+        return ok;
+    }
+};
+
+template <const char* Spec>
+constexpr size_t StaticFormat<Spec>::Length;
+
+}
+
+#endif
@@ -0,0 +1,60 @@
+/**
+ * (c) Luke Humphreys 2017
+ */
+#ifndef __ELF_64_UTIL_TIME_INGEST__
+#define __ELF_64_UTIL_TIME_INGEST__
+
+#include "util_time.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace nstimestamp {
+
+/**
+ * Parallel ingest of a (large) column of timestamps.
+ *
+ * The input is split into new-line aligned chunks, which are processed by a
+ * work-stealing pool of threads:
+ *   1. Lines are counted in each chunk, to size a single output array
+ *   2. The timestamp at the start of each line is parsed (in any format
+ *      accepted by Time::InitialiseFromString) directly into its slot
+ *
+ * The output holds one epoch-ns value per line, in file order. No allocation
+ * is made per record. Lines which are too short to hold a timestamp produce
+ * the Epoch (0), exactly as Time would.
+ */
+class TimestampIngest {
+public:
+    static const size_t DEFAULT_CHUNK_BYTES = 1024 * 1024;
+
+    /**
+     * @param threads     Number of worker threads (0: hardware concurrency)
+     * @param chunkBytes  Target chunk size. Chunks are extended to the end of
+     *                    the line, so a chunk is never empty. For very
+     *                    large inputs the size is raised, so that there are
+     *                    at most 2^32 - 1 chunks.
+     */
+    TimestampIngest(size_t threads = 0, size_t chunkBytes = DEFAULT_CHUNK_BYTES);
+
+    /**
+     * Ingest the file at path (memory mapped).
+     *
+     * Returns false, leaving epochNs empty, if the file cannot be read.
+     */
+    bool Ingest(const std::string& path, std::vector<long>& epochNs) const;
+
+    // Ingest an in-memory buffer.
+    void Ingest(const char* data, size_t size, std::vector<long>& epochNs) const;
+
+    size_t Threads() const { return threads; }
+    size_t ChunkBytes() const { return chunkBytes; }
+
+private:
+    const size_t threads;
+    const size_t chunkBytes;
+};
+
+}
+
+#endif
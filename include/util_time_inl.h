@@ -0,0 +1,114 @@
+/**
+ * (c) Luke Humphreys 2017
+ *
+ * Hot-path definitions for the Time class.
+ *
+ * In the default build these are compiled into the Time library by
+ * util_time.cpp. When NSTIMESTAMP_HEADER_ONLY is defined they are included
+ * by util_time.h and marked inline.
+ */
+#ifndef __ELF_64_UTIL_TIME_INL__
+#define __ELF_64_UTIL_TIME_INL__
+
+#include "util_time.h"
+#include <ctime>
+
+namespace nstimestamp {
+
+NSTIMESTAMP_INLINE Time::Time() {
+    SetNow();
+}
+
+NSTIMESTAMP_INLINE Time::Time(const Time& rhs)
+    : ts(rhs.ts)
+{
+    data.ready = false;
+}
+
+NSTIMESTAMP_INLINE Time::Time(const struct timeval& tv) {
+    (*this) = tv;
+}
+
+NSTIMESTAMP_INLINE Time& Time::operator=(const struct timeval& tv) {
+    ts.tv_sec = tv.tv_sec;
+    ts.tv_nsec = tv.tv_usec * 1000;
+    data.ready = false;
+    return *this;
+}
+
+NSTIMESTAMP_INLINE Time::Time(const struct timespec& tv)
+    : ts(tv)
+{
+    data.ready = false;
+}
+
+NSTIMESTAMP_INLINE Time Time::FromEpochNSecs(long epochNs) {
+    return Time(time_detail::ToTimespec(epochNs));
+}
+
+NSTIMESTAMP_INLINE Time& Time::operator=(const struct timespec& tv) {
+    ts = tv;
+    data.ready = false;
+    return *this;
+}
+
+NSTIMESTAMP_INLINE Time& Time::operator=(const Time& rhs) {
+    this->ts = rhs.ts;
+    data.ready = false;
+    return *this;
+}
+
+NSTIMESTAMP_INLINE Time& Time::SetNow() {
+    clock_gettime(CLOCK_REALTIME, &ts);
+    data.ready = false;
+    return *this;
+}
+
+/*
+ * NOTE: Rounded down (as was the original second / nano-second comparison),
+ *       but via the nano-second diff, since a leap second's tv_nsec may
+ *       exceed a second.
+ */
+NSTIMESTAMP_INLINE int Time::DiffSecs(const Time& rhs) const {
+    return time_detail::FloorDiv(DiffNSecs(rhs), time_detail::NS_PER_SEC);
+}
+
+NSTIMESTAMP_INLINE long Time::DiffUSecs(const Time& rhs) const {
+    long diff = (  static_cast<long>(ts.tv_sec) -
+                   static_cast<long>(rhs.ts.tv_sec)
+                )*1000000L;
+    diff+=((ts.tv_nsec - rhs.ts.tv_nsec) / 1000);
+    return diff;
+}
+
+NSTIMESTAMP_INLINE long Time::DiffNSecs(const Time& rhs) const {
+    long diff = (  static_cast<long>(ts.tv_sec) -
+                   static_cast<long>(rhs.ts.tv_sec)
+                )*1000000000L;
+    diff+=(ts.tv_nsec - rhs.ts.tv_nsec);
+    return diff;
+}
+
+/*
+ * NOTE: Derived from EpochNSecs (rather than ts.tv_sec) so that a leap
+ *       second agrees with it, reading as the following second.
+ */
+NSTIMESTAMP_INLINE int Time::EpochSecs() const {
+    return time_detail::FloorDiv(EpochNSecs(), time_detail::NS_PER_SEC);
+}
+
+/*
+ * NOTE: Pure integer arithmetic - multiplying by a floating point literal
+ *       (1e9L) forces a round trip through the x87 unit.
+ */
+NSTIMESTAMP_INLINE long Time::EpochUSecs() const {
+    return ts.tv_nsec / 1000 + 1000000L * static_cast<long>(ts.tv_sec);
+}
+
+NSTIMESTAMP_INLINE long Time::EpochNSecs() const {
+    return ts.tv_nsec + 1000000000L * static_cast<long>(ts.tv_sec);
+}
+
+}
+
+#endif
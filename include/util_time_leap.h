@@ -0,0 +1,131 @@
+/**
+ * (c) Luke Humphreys 2017
+ */
+#ifndef __ELF_64_UTIL_TIME_LEAP__
+#define __ELF_64_UTIL_TIME_LEAP__
+
+#include "util_time.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace nstimestamp {
+
+/**
+ * Leap-second table, and conversion between UTC and TAI.
+ *
+ * Time (like POSIX) ignores leap seconds: every day is 86400 seconds long.
+ * A leap second is represented as an extra second of nano-seconds on top of
+ * 23:59:59 (see Time::IsLeapSecond), and is rendered as 23:59:60.
+ *
+ * TAI values are nano-seconds since 1970-01-01 00:00:00 TAI, so that
+ * differences between them are true elapsed SI nano-seconds.
+ *
+ * Before 1972 (the start of the table) the 1972 offset of 10s is assumed.
+ * Only positive leap seconds are supported: none other has ever occurred.
+ *
+ * A table is not modified once loaded, and may be shared between threads.
+ */
+class LeapSeconds {
+public:
+    static const char* const SYSTEM_LIST;
+
+    // Initialise with the built-in table (current to the 2017 leap second)
+    LeapSeconds();
+
+    /**
+     * Replace the table with the contents of an IERS / NIST leap-seconds.list
+     * file.
+     *
+     * Returns false, leaving the table untouched, if the file cannot be read,
+     * or is not a valid table.
+     */
+    bool Load(const std::string& path = SYSTEM_LIST);
+
+    // Number of entries (offset changes) in the table
+    size_t Size() const { return entries.size(); }
+
+    // TAI - UTC, in seconds, at utc
+    int TaiOffset(const Time& utc) const;
+
+    // nano-seconds since the TAI epoch
+    long UtcToTai(const Time& utc) const;
+    Time TaiToUtc(long taiNs) const;
+
+    /**
+     * Batch conversion of count values. The epoch-ns overload can not
+     * represent a leap second, which (as with EpochNSecs) reads as the
+     * following second.
+     */
+    void UtcToTai(const Time* utc, long* taiNs, size_t count) const;
+    void UtcToTai(const long* utcNs, long* taiNs, size_t count) const;
+
+    // Diffs, in elapsed SI units: (lhs - rhs)
+    int  DiffSecs(const Time& lhs, const Time& rhs) const;
+    long DiffUSecs(const Time& lhs, const Time& rhs) const;
+    long DiffNSecs(const Time& lhs, const Time& rhs) const;
+
+    /**
+     * Conversions for a (broadly) monotonic sequence of times.
+     *
+     * The cursor caches the span of the table containing the last value
+     * converted, so each conversion is a range check and an add. The table
+     * is only searched when the span is left, which (for monotonically
+     * advancing input) happens at most once per leap second.
+     *
+     * A cursor must not be shared between threads.
+     */
+    class Cursor {
+    public:
+        explicit Cursor(const LeapSeconds& table);
+
+        long UtcToTai(long utcNs) {
+            if (utcNs < utcFrom || utcNs >= utcTo) {
+                SeekUtc(utcNs);
+            }
+            return utcNs + offsetNs;
+        }
+
+        long UtcToTai(const Time& utc) {
+            const long utcNs = utc.EpochNSecs();
+            if (!utc.IsLeapSecond()) {
+                return UtcToTai(utcNs);
+            }
+            // Look up the offset from 23:59:59, before the leap second
+            return UtcToTai(utcNs - time_detail::NS_PER_SEC) + time_detail::NS_PER_SEC;
+        }
+
+        Time TaiToUtc(long taiNs);
+
+    private:
+        void SeekUtc(long utcNs);
+        void SeekTai(long taiNs);
+        void Select(size_t index);
+
+        const LeapSeconds& table;
+
+        // UTC epoch-ns [utcFrom, utcTo) share offsetNs
+        long utcFrom;
+        long utcTo;
+
+        // TAI ns [taiFrom, taiTo). Includes the leap second ending the span
+        long taiFrom;
+        long taiTo;
+
+        long offsetNs;
+    };
+
+private:
+    struct Entry {
+        // UTC epoch-ns from which the offset applies
+        long utcNs;
+        // TAI - UTC
+        long offsetNs;
+    };
+
+    std::vector<Entry> entries;
+};
+
+}
+
+#endif
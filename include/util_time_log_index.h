@@ -0,0 +1,123 @@
+/**
+ * (c) Luke Humphreys 2017
+ */
+#ifndef __ELF_64_UTIL_TIME_LOG_INDEX__
+#define __ELF_64_UTIL_TIME_LOG_INDEX__
+
+#include "util_time.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace nstimestamp {
+
+class MappedFile;
+
+/**
+ * Sparse time index of a (large) log file, persisted to a sidecar file.
+ *
+ * Lines are expected to start with a timestamp in one of the formats
+ * accepted by Time (Timestamp() or ISO8601), and to be in time order. Lines
+ * which do not start with a timestamp (e.g. continuation lines) are treated
+ * as part of the preceding line.
+ *
+ * Every stride'th line is recorded in the index (its epoch-ns and byte
+ * offset). Range queries binary search the index, and then scan at most
+ * stride lines of the (memory mapped) log either side.
+ */
+class LogTimeIndex {
+public:
+    static const size_t DEFAULT_STRIDE = 1024;
+
+    struct Entry {
+        int64_t  epochNs;
+        uint64_t offset;
+    };
+
+    // A byte range in the log: [begin, end)
+    struct Range {
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    /**
+     * Load the existing sidecar (if there is one, and it is valid for the
+     * log). No indexing is done until Update() is called.
+     *
+     * @param logPath  The log file to index
+     * @param stride   Index every stride'th line. Only used when a new index
+     *                 is created: an existing sidecar retains its stride.
+     */
+    LogTimeIndex(const std::string& logPath, size_t stride = DEFAULT_STRIDE);
+
+    /**
+     * Index any complete lines appended to the log since the last update,
+     * and save them to the sidecar. If the log has been truncated, or
+     * replaced (detected by its inode, and a fingerprint of the first and
+     * last indexed lines), the index is rebuilt.
+     *
+     * Returns false if the log could not be read, or the sidecar written.
+     */
+    bool Update();
+
+    /**
+     * The byte range of the lines whose timestamps are in [from, to).
+     *
+     * Lines appended since the last Update() are found, but are scanned
+     * rather than indexed. If the log no longer matches the index, the
+     * whole log is scanned.
+     */
+    Range Find(const Time& from, const Time& to) const;
+
+    /**
+     * Invoke callback with each line (excluding its new-line) in [from, to).
+     *
+     * Returns the number of lines visited.
+     */
+    size_t ForEachLine(
+        const Time& from,
+        const Time& to,
+        const std::function<void (const char* line, size_t len)>& callback) const;
+
+    const std::vector<Entry>& Entries() const { return entries; }
+    size_t Stride() const { return stride; }
+    uint64_t IndexedBytes() const { return indexedBytes; }
+    uint64_t IndexedLines() const { return indexedLines; }
+    const std::string& SidecarPath() const { return sidecarPath; }
+
+    // The sidecar used for the log: <logPath>.tidx
+    static std::string SidecarPath(const std::string& logPath);
+
+private:
+    void Load();
+    void Reset();
+    bool Save(size_t firstNewEntry, bool rebuild) const;
+
+    // True if the log still starts with the indexed content
+    bool Matches(const MappedFile& log) const;
+
+    Range Find(const MappedFile& log, const Time& from, const Time& to) const;
+
+    // Offset from which to scan for the first line at, or after, epochNs
+    uint64_t ScanStart(long epochNs) const;
+
+    std::string        logPath;
+    std::string        sidecarPath;
+    size_t             stride;
+    uint64_t           inode;
+    uint64_t           indexedBytes;
+    uint64_t           indexedLines;
+
+    // Fingerprint: the first line's (prefix), and the last indexed line's
+    uint64_t           headBytes;
+    uint64_t           headHash;
+    uint64_t           tailOffset;
+    uint64_t           tailHash;
+
+    std::vector<Entry> entries;
+};
+
+}
+
+#endif
@@ -0,0 +1,93 @@
+/**
+ * (c) Luke Humphreys 2017
+ */
+#ifndef __ELF_64_UTIL_TIME_RATE_METER__
+#define __ELF_64_UTIL_TIME_RATE_METER__
+
+#include "util_time.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace nstimestamp {
+
+/**
+ * Lock-free event rate meter.
+ *
+ * Events are counted into a ring of fixed width time buckets. Each writer
+ * thread is assigned a shard of the ring, so that concurrent writers do not
+ * contend on the same cache-line. Neither writers nor readers ever block.
+ *
+ * Queries cover the most recent *complete* buckets prior to the provided
+ * time; the bucket currently being written is excluded.
+ *
+ * Limitations:
+ *   - At most 2^32-1 events may be recorded per bucket, per shard.
+ *   - Events older than the ring (or older than the data already in their
+ *     slot) are discarded.
+ */
+class RateMeter {
+public:
+    /**
+     * @param bucketWidthNs  The width of each bucket, in nano-seconds
+     * @param buckets        The number of complete buckets retained, which
+     *                       is the largest window that may be queried.
+     * @param shards         The number of writer shards. Defaults to the
+     *                       number of hardware threads.
+     */
+    RateMeter(long bucketWidthNs, size_t buckets, size_t shards = 0);
+
+    RateMeter(const RateMeter& rhs) = delete;
+    RateMeter& operator=(const RateMeter& rhs) = delete;
+
+    // Record count events, occurring now.
+    void Record(uint32_t count = 1);
+
+    // Record count events, occurring at the time provided.
+    void Record(const Time& when, uint32_t count = 1);
+
+    /**
+     * The number of events recorded in the (up to) buckets complete buckets
+     * immediately before now.
+     */
+    uint64_t Count(const Time& now, size_t buckets) const;
+
+    // Mean rate, in events per second, over the window
+    double Rate(const Time& now, size_t buckets) const;
+
+    // Rate, in events per second, of the busiest bucket in the window
+    double PeakRate(const Time& now, size_t buckets) const;
+
+    /**
+     * Exponentially weighted moving average of the rate (events per second)
+     * with the provided time constant, calculated across all retained
+     * buckets.
+     */
+    double EWMARate(const Time& now, long timeConstantNs) const;
+
+    long BucketWidthNSecs() const { return bucketWidth; }
+    size_t Buckets() const { return ringSize - 1; }
+    size_t Shards() const { return shards; }
+
+private:
+    typedef std::atomic<uint64_t> Slot;
+
+    long BucketIndex(const Time& time) const;
+
+    /**
+     * The number of events recorded (in all shards) in the bucket
+     */
+    uint64_t BucketCount(long bucket) const;
+
+    Slot& GetSlot(size_t shard, long bucket) const;
+
+    const long   bucketWidth;
+    const size_t ringSize;
+    const size_t shards;
+    const size_t shardStride;
+    std::unique_ptr<Slot[]> slots;
+};
+
+}
+
+#endif
@@ -0,0 +1,133 @@
+/**
+ * (c) Luke Humphreys 2017
+ */
+#ifndef __ELF_64_UTIL_TIME_SHARED_CLOCK__
+#define __ELF_64_UTIL_TIME_SHARED_CLOCK__
+
+#include "util_time.h"
+#include <cstdint>
+#include <string>
+
+namespace nstimestamp {
+
+namespace shared_clock_detail {
+    // The shared-memory layout (see util_time_shared_clock.cpp)
+    struct Segment;
+}
+
+/**
+ * Read the raw, free running, counter used by the shared clock.
+ *
+ * On x86_64 this is the TSC (which must be invariant, and synchronised
+ * across cores). Elsewhere CLOCK_MONOTONIC_RAW is used.
+ */
+uint64_t ReadClockCounter();
+
+/**
+ * Parameters mapping the counter onto wall-clock time:
+ *
+ *     epochNs = baseNs + offsetNs + ((counter - baseCounter) * mult) >> shift
+ */
+struct SharedClockParams {
+    uint64_t baseCounter;
+    int64_t  baseNs;
+    uint64_t mult;
+    uint32_t shift;
+    // Additional correction, applied by all readers
+    int64_t  offsetNs;
+};
+
+/**
+ * Publishes clock parameters to a named shared-memory segment.
+ *
+ * Updates are protected by a seqlock: readers never block the publisher,
+ * and retry if they observe an update in progress.
+ *
+ * There must be a single publisher per segment. A publisher which dies
+ * mid-update leaves the segment unusable (readers fall back to
+ * clock_gettime) until a replacement publisher is created, and publishes.
+ */
+class SharedClockPublisher {
+public:
+    /**
+     * Create (or open) the segment. The name should be of the form
+     * "/somename", as required by shm_open.
+     */
+    SharedClockPublisher(const std::string& name);
+    ~SharedClockPublisher();
+
+    SharedClockPublisher(const SharedClockPublisher& rhs) = delete;
+    SharedClockPublisher& operator=(const SharedClockPublisher& rhs) = delete;
+
+    // False if the segment could not be created
+    bool IsOpen() const { return segment != nullptr; }
+
+    void Publish(const SharedClockParams& params);
+
+    /**
+     * Measure the counter against CLOCK_REALTIME over (approximately)
+     * sampleNs, and produce the corresponding parameters.
+     */
+    static SharedClockParams Calibrate(long sampleNs, long offsetNs = 0);
+
+    // Remove the segment's name (existing mappings remain valid)
+    void Unlink();
+
+private:
+    std::string                   name;
+    shared_clock_detail::Segment* segment;
+};
+
+/**
+ * Computes the current time from the published parameters, without any
+ * system calls or locks.
+ *
+ * If the segment is mid-update for longer than expected (the publisher died,
+ * or was de-scheduled), the reader continues with the last parameters it
+ * read, so that it stays on the shared, calibrated, clock. Only if the
+ * reader has never read any parameters (the segment does not exist, or has
+ * not been published to) does it fall back to clock_gettime.
+ *
+ * The last parameters are cached in the reader: a reader must not be shared
+ * between threads.
+ */
+class SharedClockReader {
+public:
+    SharedClockReader(const std::string& name);
+    ~SharedClockReader();
+
+    SharedClockReader(const SharedClockReader& rhs) = delete;
+    SharedClockReader& operator=(const SharedClockReader& rhs) = delete;
+
+    bool IsOpen() const { return segment != nullptr; }
+
+    // True if the current parameters could be read
+    bool IsPublished() const;
+
+    // Reset time to the current (shared) time
+    Time& SetNow(Time& time) const;
+
+    // nano-seconds since the epoch
+    long EpochNSecs() const;
+
+    /**
+     * Take a consistent copy of the current parameters.
+     *
+     * Returns false if nothing has been published.
+     */
+    bool Params(SharedClockParams& params) const;
+
+private:
+    // Read the parameters, updating the cache on success
+    bool Read(SharedClockParams& params) const;
+
+    const shared_clock_detail::Segment* segment;
+
+    // The last consistent parameters read
+    mutable SharedClockParams lastParams;
+    mutable bool              hasLastParams;
+};
+
+}
+
+#endif
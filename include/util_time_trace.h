@@ -0,0 +1,93 @@
+/**
+ * (c) Luke Humphreys 2017
+ */
+#ifndef __ELF_64_UTIL_TIME_TRACE__
+#define __ELF_64_UTIL_TIME_TRACE__
+
+#include "util_time.h"
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+namespace nstimestamp {
+
+/**
+ * Process wide span recording, for export as a timeline.
+ *
+ * Spans are recorded to thread-local buffers (allocated in blocks, so there
+ * is no per-span allocation) without any locking. Spans may be nested: each
+ * End() closes the most recent open span on the calling thread.
+ *
+ * Names must be string literals (or otherwise outlive the trace): only the
+ * pointer is recorded.
+ *
+ * Export, Spans and Clear must only be called once the recording threads
+ * are quiescent. Spans which are still open are not exported.
+ *
+ * Each recording thread holds a buffer, which outlives the thread (so its
+ * spans can still be exported) until the next Clear().
+ */
+class Trace {
+public:
+    // Open a span on the calling thread
+    static void Begin(const char* name);
+
+    // Close the calling thread's most recent open span
+    static void End();
+
+    /**
+     * Record a span already measured by a pair of Times, nested within the
+     * calling thread's currently open span (if any)
+     */
+    static void Record(const char* name, const Time& start, const Time& end);
+
+    /**
+     * Write the spans, in Chrome trace-event JSON format (as loaded by
+     * chrome://tracing, or Perfetto).
+     *
+     * Each ts is micro-seconds since the earliest exported span, whose
+     * start (ns since the epoch) is recorded as otherData.baseNs
+     */
+    static void WriteChromeJSON(std::ostream& os);
+
+    /**
+     * Write the spans in a compact binary form. All integers are in host
+     * byte order:
+     *
+     *     char[8]   "NSTTRC02"
+     *     uint32_t  Number of names
+     *     Names:    uint32_t length, followed by length bytes
+     *     uint64_t  Number of spans
+     *     Spans:    int64_t   start (ns since the epoch)
+     *               int64_t   duration (ns)
+     *               uint32_t  name index
+     *               uint32_t  thread id
+     *               uint32_t  depth
+     */
+    static void WriteBinary(std::ostream& os);
+
+    // Total spans recorded (open or closed) across all threads
+    static size_t Spans();
+
+    // Discard all recorded spans, freeing the buffers of exited threads
+    static void Clear();
+
+    // Thread buffers currently held
+    static size_t Buffers();
+};
+
+/**
+ * Scoped span: Begin on construction, End on destruction
+ */
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name) { Trace::Begin(name); }
+    ~TraceSpan() { Trace::End(); }
+
+    TraceSpan(const TraceSpan& rhs) = delete;
+    TraceSpan& operator=(const TraceSpan& rhs) = delete;
+};
+
+}
+
+#endif
@@ -0,0 +1,61 @@
+/**
+ * (c) Luke Humphreys 2017
+ */
+#ifndef __ELF_64_UTIL_TIME_UNIQUE__
+#define __ELF_64_UTIL_TIME_UNIQUE__
+
+#include "util_time.h"
+#include <atomic>
+#include <cstdint>
+
+namespace nstimestamp {
+
+/**
+ * Generates timestamps which are unique across all threads in the process,
+ * suitable for use as event identifiers.
+ *
+ * The last value handed out is held as a single 64-bit epoch-ns value, and
+ * advanced with a lock-free compare-and-swap. Where the clock has not moved
+ * on since the previous call, the value is advanced by a single nano-second.
+ *
+ * Two modes are supported:
+ *
+ *   Strict (batchSize == 1): Every value is strictly greater than any value
+ *                            previously returned, by any thread.
+ *
+ *   Batched (batchSize > 1): Each thread reserves batchSize values at a
+ *                            time, and hands them out without touching the
+ *                            shared value. Values remain unique, and are
+ *                            strictly increasing on each thread, but
+ *                            concurrent threads may interleave. No value is
+ *                            more than batchSize ns ahead of the clock.
+ */
+class UniqueTimeGenerator {
+public:
+    explicit UniqueTimeGenerator(uint32_t batchSize = 1);
+
+    UniqueTimeGenerator(const UniqueTimeGenerator& rhs) = delete;
+    UniqueTimeGenerator& operator=(const UniqueTimeGenerator& rhs) = delete;
+
+    // nano-seconds since the epoch
+    long NextNSecs();
+
+    // Reset time to the next unique timestamp
+    Time& Next(Time& time);
+
+    Time Next();
+
+    uint32_t BatchSize() const { return batchSize; }
+
+private:
+    long Reserve(long now, long count, long& end);
+
+    // Identifies this generator to each thread's batches
+    const uint64_t id;
+    const uint32_t batchSize;
+    alignas(64) std::atomic<long> last;
+};
+
+}
+
+#endif
@@ -5,7 +5,23 @@
 #include <chrono>
 #include <iomanip>
 #include <util_time.h>
+#include <util_time_format.h>
+#include <util_time_rate_meter.h>
+#include <util_time_shared_clock.h>
+#include <util_time_unique.h>
+#include <util_time_log_index.h>
+#include <util_time_ingest.h>
+#include <util_time_trace.h>
+#include <util_time_leap.h>
+#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <cstdio>
+#include <ctime>
 #include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
 
 using namespace nstimestamp;
 
@@ -99,6 +115,545 @@ namespace TimeBench {
             }
         }, numEvents);
     }
+
+    void DiffNSecs() {
+        const uint_fast32_t numEvents = 1e6;
+        Time origin;
+        Time now;
+        long total = 0;
+        BENCHMARK("Time - Capture & DiffNSecs", {
+            for (uint_fast32_t i = 0; i < numEvents; ++i) {
+                total += now.SetNow().DiffNSecs(origin);
+            }
+        }, numEvents);
+        std::cout << "    (checksum: " << (total != 0) << ")" << std::endl;
+    }
+
+    void EpochNSecs() {
+        const uint_fast32_t numEvents = 1e6;
+        std::vector<Time> events(numEvents);
+        long total = 0;
+        BENCHMARK("Time - EpochNSecs", {
+            for (const Time& event: events) {
+                total += event.EpochNSecs();
+            }
+        }, numEvents);
+        std::cout << "    (checksum: " << (total != 0) << ")" << std::endl;
+    }
+
+    void Copy() {
+        const uint_fast32_t numEvents = 1e6;
+        std::vector<Time> events(numEvents);
+        std::vector<Time> copies;
+        copies.reserve(numEvents);
+        BENCHMARK("Time - Copy", {
+            for (const Time& event: events) {
+                copies.emplace_back(event);
+            }
+        }, numEvents);
+    }
+}
+
+namespace FormatBench {
+    constexpr char CSVSpec[] = "%Y-%m-%d %H:%M:%S.%3N";
+    typedef StaticFormat<CSVSpec> CSVFormat;
+
+    void WriteStaticFormat() {
+        const uint_fast32_t numEvents = 1e6;
+        const Time reftime("20140403 10:11:02.294930000");
+        char buf[CSVFormat::Length];
+        BENCHMARK("StaticFormat - Write (CSV)", {
+            for (uint_fast32_t i = 0; i < numEvents; ++i) {
+                Time eventTime(reftime);
+                CSVFormat::Write(eventTime, buf);
+            }
+        }, numEvents);
+    }
+
+    void StringStaticFormat() {
+        const uint_fast32_t numEvents = 1e6;
+        const Time reftime("20140403 10:11:02.294930000");
+        BENCHMARK("StaticFormat - Format (CSV)", {
+            std::string theTime;
+            for (uint_fast32_t i = 0; i < numEvents; ++i) {
+                theTime = CSVFormat::Format(Time(reftime));
+            }
+        }, numEvents);
+    }
+
+    void StringTimestamp() {
+        const uint_fast32_t numEvents = 1e6;
+        const Time reftime("20140403 10:11:02.294930000");
+        BENCHMARK("Timestamp()", {
+            std::string theTime;
+            for (uint_fast32_t i = 0; i < numEvents; ++i) {
+                theTime = Time(reftime).Timestamp();
+            }
+        }, numEvents);
+    }
+
+    void WriteStrftime() {
+        const uint_fast32_t numEvents = 1e6;
+        const Time reftime("20140403 10:11:02.294930000");
+        char buf[32];
+        BENCHMARK("strftime - Write (CSV)", {
+            for (uint_fast32_t i = 0; i < numEvents; ++i) {
+                const time_t secs = reftime.EpochSecs();
+                tm parts;
+                gmtime_r(&secs, &parts);
+                size_t len = strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &parts);
+                snprintf(buf + len, sizeof(buf) - len, ".%03d", reftime.MSec());
+            }
+        }, numEvents);
+    }
+
+    void ParseStaticFormat() {
+        const uint_fast32_t numEvents = 1e6;
+        const std::string reftime = "2014-04-03 10:11:02.294";
+        Time parsed;
+        BENCHMARK("StaticFormat - Parse (CSV)", {
+            for (uint_fast32_t i = 0; i < numEvents; ++i) {
+                CSVFormat::Parse(reftime, parsed);
+            }
+        }, numEvents);
+    }
+
+    void ParseStrptime() {
+        const uint_fast32_t numEvents = 1e6;
+        const std::string reftime = "2014-04-03 10:11:02.294";
+        BENCHMARK("strptime - Parse (CSV)", {
+            for (uint_fast32_t i = 0; i < numEvents; ++i) {
+                tm parts = {};
+                const char* rest = strptime(reftime.c_str(), "%Y-%m-%d %H:%M:%S", &parts);
+                timespec ts;
+                ts.tv_sec = timegm(&parts);
+                ts.tv_nsec = atoi(rest + 1) * 1000000;
+                Time parsed(ts);
+            }
+        }, numEvents);
+    }
+}
+
+namespace RateMeterBench {
+    void Record() {
+        const uint_fast32_t numEvents = 1e6;
+        RateMeter meter(1000000, 1000);
+        Time eventTime;
+        BENCHMARK("RateMeter - Record (provided Time)", {
+            for (uint_fast32_t i = 0; i < numEvents; ++i) {
+                meter.Record(eventTime);
+            }
+        }, numEvents);
+    }
+
+    void RecordNow() {
+        const uint_fast32_t numEvents = 1e6;
+        RateMeter meter(1000000, 1000);
+        BENCHMARK("RateMeter - Record (now)", {
+            for (uint_fast32_t i = 0; i < numEvents; ++i) {
+                meter.Record();
+            }
+        }, numEvents);
+    }
+
+    /**
+     * Many writers, stamping and recording their own events, while a reader
+     * continuously queries the meter.
+     */
+    void ConcurrentWriters(size_t writers) {
+        const uint_fast32_t numEvents = 1e6;
+        RateMeter meter(1000000, 1000);
+        std::atomic<bool> done(false);
+        double lastRate = 0;
+        size_t queries = 0;
+        std::thread reader([&] () -> void {
+            while (!done.load()) {
+                Time now;
+                lastRate = meter.Rate(now, 100) +
+                           meter.PeakRate(now, 100) +
+                           meter.EWMARate(now, 10000000);
+                ++queries;
+            }
+        });
+
+        const std::string name = "RateMeter - " + std::to_string(writers) +
+                                 " writers + reader";
+        BENCHMARK(name, {
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < writers; ++t) {
+                threads.emplace_back([&meter, writers] () -> void {
+                    for (uint_fast32_t i = 0; i < numEvents / writers; ++i) {
+                        meter.Record();
+                    }
+                });
+            }
+            for (std::thread& thread: threads) {
+                thread.join();
+            }
+        }, numEvents);
+
+        done = true;
+        reader.join();
+        std::cout << "    (reader queries: " << queries
+                  << ", checksum: " << (lastRate >= 0) << ")" << std::endl;
+    }
+}
+
+namespace SharedClockBench {
+    const std::string segmentName = "/nstimestamp_benchmark_" + std::to_string(getpid());
+
+    void ReaderCapture() {
+        const uint_fast32_t numEvents = 1e6;
+        SharedClockPublisher publisher(segmentName);
+        publisher.Publish(SharedClockPublisher::Calibrate(10000000));
+        SharedClockReader reader(segmentName);
+        publisher.Unlink();
+
+        Time updateTime;
+        BENCHMARK("SharedClock - Event Capture (prealloc)", {
+            for (uint_fast32_t i = 0; i < numEvents; ++i) {
+                reader.SetNow(updateTime);
+            }
+        }, numEvents);
+    }
+
+    /**
+     * Each of the reader processes captures numEvents events, whilst the
+     * publisher continually re-publishes.
+     *
+     * Each reader times its own loop, and reports back over a pipe, so that
+     * the fork()s (and the calibration) are not included in the result.
+     */
+    void MultiProcessCapture(size_t processes) {
+        const uint_fast32_t numEvents = 1e6;
+        SharedClockPublisher publisher(segmentName);
+        const SharedClockParams params = SharedClockPublisher::Calibrate(10000000);
+        publisher.Publish(params);
+
+        int results[2];
+        if (pipe(results) != 0) {
+            return;
+        }
+
+        std::vector<pid_t> readers;
+        for (size_t p = 0; p < processes; ++p) {
+            const pid_t pid = fork();
+            if (pid == 0) {
+                SharedClockReader reader(segmentName);
+                Time updateTime;
+                const auto start = std::chrono::high_resolution_clock::now();
+                for (uint_fast32_t i = 0; i < numEvents; ++i) {
+                    reader.SetNow(updateTime);
+                }
+                const auto end = std::chrono::high_resolution_clock::now();
+                const long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+                _exit(write(results[1], &ns, sizeof(ns)) == sizeof(ns) ? 0 : 1);
+            }
+            readers.push_back(pid);
+        }
+        close(results[1]);
+
+        // Keep the seqlock busy until every reader has reported
+        size_t running = readers.size();
+        while (running > 0) {
+            publisher.Publish(params);
+            for (pid_t& pid: readers) {
+                if (pid > 0 && waitpid(pid, nullptr, WNOHANG) == pid) {
+                    pid = 0;
+                    --running;
+                }
+            }
+        }
+
+        // Total time spent reading, across all readers
+        long totalNs = 0;
+        long ns = 0;
+        while (read(results[0], &ns, sizeof(ns)) == sizeof(ns)) {
+            totalNs += ns;
+        }
+        close(results[0]);
+
+        const std::string name = "SharedClock - " + std::to_string(processes) +
+                                 " reader processes";
+        const auto origin = std::chrono::high_resolution_clock::now();
+        report(name, origin, origin + std::chrono::nanoseconds(totalNs), numEvents * processes);
+        publisher.Unlink();
+    }
+}
+
+namespace UniqueTimeBench {
+    /**
+     * numEvents stamps, split across the given number of threads
+     */
+    template <class Stamp>
+    void Threaded(const std::string& test, size_t threads, Stamp stamp) {
+        const uint_fast32_t numEvents = 1e6;
+        const std::string name = test + " (" + std::to_string(threads) + " threads)";
+        BENCHMARK(name, {
+            std::vector<std::thread> workers;
+            for (size_t t = 0; t < threads; ++t) {
+                workers.emplace_back([&stamp, threads] () -> void {
+                    for (uint_fast32_t i = 0; i < numEvents / threads; ++i) {
+                        stamp();
+                    }
+                });
+            }
+            for (std::thread& worker: workers) {
+                worker.join();
+            }
+        }, numEvents);
+    }
+
+    void Scaling() {
+        const size_t maxThreads =
+            std::max<size_t>(4, 2 * std::thread::hardware_concurrency());
+        for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+            Threaded("Time - Capture", threads, [] () -> void {
+                Time();
+            });
+
+            UniqueTimeGenerator strict;
+            Threaded("UniqueTime - Strict", threads, [&strict] () -> void {
+                strict.NextNSecs();
+            });
+
+            UniqueTimeGenerator batched(64);
+            Threaded("UniqueTime - Batched(64)", threads, [&batched] () -> void {
+                batched.NextNSecs();
+            });
+        }
+    }
+}
+
+namespace LogIndexBench {
+    const long SEC = 1000000000L;
+    const long logStart = 1396519862L * SEC;
+    const long logLines = 2000000;
+    // 100 lines per second
+    const long lineSpacing = SEC / 100;
+
+    std::string LogPath() {
+        return "/tmp/nstimestamp_benchmark_" + std::to_string(getpid()) + ".log";
+    }
+
+    void WriteLog(const std::string& path) {
+        std::ofstream log(path, std::ios::trunc);
+        for (long i = 0; i < logLines; ++i) {
+            log << Time::FromEpochNSecs(logStart + i * lineSpacing).Timestamp()
+                << " INFO Processed message " << i << "\n";
+        }
+    }
+
+    /**
+     * The alternative: read every line, and construct a Time for each
+     */
+    size_t FullScan(const std::string& path, const Time& from, const Time& to) {
+        std::ifstream log(path);
+        std::string line;
+        size_t matches = 0;
+        while (std::getline(log, line)) {
+            const Time stamp(line);
+            if (stamp.DiffNSecs(from) >= 0 && stamp.DiffNSecs(to) < 0) {
+                ++matches;
+            }
+        }
+        return matches;
+    }
+
+    void RangeQuery() {
+        const std::string path = LogPath();
+        WriteLog(path);
+        const long logDuration = logLines * lineSpacing;
+
+        LogTimeIndex index(path);
+        BENCHMARK("LogTimeIndex - Build (2M lines)", {
+            index.Update();
+        }, logLines);
+
+        // One minute windows, spread across the log
+        const uint_fast32_t numQueries = 1000;
+        size_t indexedMatches = 0;
+        BENCHMARK("LogTimeIndex - 1 minute range query", {
+            for (uint_fast32_t i = 0; i < numQueries; ++i) {
+                const long from = logStart + (logDuration - 60 * SEC) / numQueries * i;
+                index.ForEachLine(Time::FromEpochNSecs(from),
+                                  Time::FromEpochNSecs(from + 60 * SEC),
+                                  [&indexedMatches] (const char*, size_t) -> void {
+                    ++indexedMatches;
+                });
+            }
+        }, numQueries);
+
+        const uint_fast32_t numScans = 3;
+        size_t scannedMatches = 0;
+        BENCHMARK("Full scan - 1 minute range query", {
+            for (uint_fast32_t i = 0; i < numScans; ++i) {
+                const long from = logStart + (logDuration - 60 * SEC) / numScans * i;
+                scannedMatches += FullScan(path,
+                                           Time::FromEpochNSecs(from),
+                                           Time::FromEpochNSecs(from + 60 * SEC));
+            }
+        }, numScans);
+        std::cout << "    (lines per query: " << indexedMatches / numQueries
+                  << " / " << scannedMatches / numScans << ")" << std::endl;
+
+        unlink(path.c_str());
+        unlink(LogTimeIndex::SidecarPath(path).c_str());
+    }
+}
+
+namespace IngestBench {
+    const long SEC = 1000000000L;
+    const long columnStart = 1396519862L * SEC;
+    const long columnLines = 4000000;
+
+    void WriteColumn(const std::string& path) {
+        std::ofstream column(path, std::ios::trunc);
+        for (long i = 0; i < columnLines; ++i) {
+            timespec ts;
+            ts.tv_sec = columnStart / SEC + i / 1000;
+            ts.tv_nsec = (i % 1000) * 1000000 + i % 997;
+            column << Time(ts).Timestamp() << "\n";
+        }
+    }
+
+    void Ingest(const std::string& path, size_t threads) {
+        const TimestampIngest ingest(threads);
+        std::vector<long> epochNs;
+        const std::string name = "TimestampIngest - " + std::to_string(threads) + " threads";
+        BENCHMARK(name, {
+            ingest.Ingest(path, epochNs);
+        }, columnLines);
+    }
+
+    /**
+     * Scaling from a single thread, to all cores
+     */
+    void Scaling() {
+        const std::string path =
+            "/tmp/nstimestamp_benchmark_ingest_" + std::to_string(getpid());
+        WriteColumn(path);
+
+        const size_t cores = std::max<size_t>(1, std::thread::hardware_concurrency());
+        for (size_t threads = 1; threads < cores; threads *= 2) {
+            Ingest(path, threads);
+        }
+        Ingest(path, cores);
+
+        unlink(path.c_str());
+    }
+}
+
+namespace TraceBench {
+    const uint_fast32_t numSpans = 2e6;
+
+    void Span() {
+        Trace::Clear();
+        BENCHMARK("TraceSpan - Scoped span", {
+            for (uint_fast32_t i = 0; i < numSpans; ++i) {
+                TraceSpan span("Span");
+            }
+        }, numSpans);
+    }
+
+    // The same two clock reads, without recording anything
+    void BareCapture() {
+        Time begin, end;
+        BENCHMARK("TraceSpan - Bare capture", {
+            for (uint_fast32_t i = 0; i < numSpans; ++i) {
+                begin.SetNow();
+                end.SetNow();
+            }
+        }, numSpans);
+    }
+
+    void WriteChromeJSON() {
+        std::ofstream out("/dev/null");
+        BENCHMARK("Trace - Chrome JSON export", {
+            Trace::WriteChromeJSON(out);
+        }, numSpans);
+    }
+
+    void WriteBinary() {
+        std::ofstream out("/dev/null");
+        BENCHMARK("Trace - Binary export", {
+            Trace::WriteBinary(out);
+        }, numSpans);
+        Trace::Clear();
+    }
+}
+
+namespace LeapBench {
+    const long SEC = 1000000000L;
+    const size_t numValues = 4000000;
+
+    // 1ms steps, across the 2016 leap second
+    std::vector<long> Column() {
+        std::vector<long> utcNs(numValues);
+        const long origin = 1483228800L * SEC - numValues / 2 * 1000000L;
+        for (size_t i = 0; i < numValues; ++i) {
+            utcNs[i] = origin + i * 1000000L;
+        }
+        return utcNs;
+    }
+
+    void BatchEpochNSecs() {
+        const LeapSeconds leaps;
+        const std::vector<long> utcNs = Column();
+        std::vector<long> taiNs(numValues);
+        BENCHMARK("LeapSeconds - Batch UTC->TAI (ns)", {
+            leaps.UtcToTai(utcNs.data(), taiNs.data(), numValues);
+        }, numValues);
+    }
+
+    void BatchTime() {
+        const LeapSeconds leaps;
+        std::vector<Time> utc;
+        utc.reserve(numValues);
+        for (const long ns: Column()) {
+            utc.push_back(Time::FromEpochNSecs(ns));
+        }
+        std::vector<long> taiNs(numValues);
+        BENCHMARK("LeapSeconds - Batch UTC->TAI (Time)", {
+            leaps.UtcToTai(utc.data(), taiNs.data(), numValues);
+        }, numValues);
+    }
+
+    void CursorTaiToUtc() {
+        const LeapSeconds leaps;
+        LeapSeconds::Cursor cursor(leaps);
+        const std::vector<long> utcNs = Column();
+        std::vector<long> taiNs(numValues);
+        leaps.UtcToTai(utcNs.data(), taiNs.data(), numValues);
+        long total = 0;
+        BENCHMARK("LeapSeconds - Cursor TAI->UTC", {
+            for (const long ns: taiNs) {
+                total += cursor.TaiToUtc(ns).EpochNSecs();
+            }
+        }, numValues);
+        if (total == 0) {
+            std::cout << "Unexpected total" << std::endl;
+        }
+    }
+
+    // No cursor: a search of the table per value
+    void Uncached() {
+        const LeapSeconds leaps;
+        std::vector<Time> utc;
+        utc.reserve(numValues);
+        for (const long ns: Column()) {
+            utc.push_back(Time::FromEpochNSecs(ns));
+        }
+        long total = 0;
+        BENCHMARK("LeapSeconds - Single UTC->TAI", {
+            for (const Time& time: utc) {
+                total += leaps.UtcToTai(time);
+            }
+        }, numValues);
+        if (total == 0) {
+            std::cout << "Unexpected total" << std::endl;
+        }
+    }
 }
 
 namespace ChronoBench {
@@ -160,6 +715,11 @@ int main(int argc, char**argv) {
     std::cout << "tm size: " << sizeof(tm) << std::endl;
     std::cout << "bool size   : " << sizeof(bool) << std::endl;
     std::cout << "Time size   : " << sizeof(Time) << std::endl;
+#ifdef NSTIMESTAMP_HEADER_ONLY
+    std::cout << "Build       : header-only" << std::endl;
+#else
+    std::cout << "Build       : static library" << std::endl;
+#endif
     BENCHMARK("[COLD] Chrono - now", {
         std::chrono::system_clock::now();
     }, 1);
@@ -193,14 +753,62 @@ int main(int argc, char**argv) {
     TimeBench::StackTime();
     ChronoBench::StackTime();
 
+    std::cout << std::endl;
+    TimeBench::DiffNSecs();
+    TimeBench::EpochNSecs();
+    TimeBench::Copy();
+
     std::cout << std::endl;
     TimeBench::WriteTimestamp();
     TimeBench::WriteISOTimestamp();
 
+    std::cout << std::endl;
+    FormatBench::WriteStaticFormat();
+    FormatBench::WriteStrftime();
+    FormatBench::StringStaticFormat();
+    FormatBench::StringTimestamp();
+
+    std::cout << std::endl;
+    FormatBench::ParseStaticFormat();
+    FormatBench::ParseStrptime();
+
     std::cout << std::endl;
     TimeBench::ReadTimestamp();
     TimeBench::ReadISOTimestamp();
 
+    std::cout << std::endl;
+    RateMeterBench::Record();
+    RateMeterBench::RecordNow();
+    RateMeterBench::ConcurrentWriters(1);
+    RateMeterBench::ConcurrentWriters(4);
+    RateMeterBench::ConcurrentWriters(16);
+
+    std::cout << std::endl;
+    SharedClockBench::ReaderCapture();
+    SharedClockBench::MultiProcessCapture(1);
+    SharedClockBench::MultiProcessCapture(4);
+
+    std::cout << std::endl;
+    UniqueTimeBench::Scaling();
+
+    std::cout << std::endl;
+    LogIndexBench::RangeQuery();
+
+    std::cout << std::endl;
+    IngestBench::Scaling();
+
+    std::cout << std::endl;
+    TraceBench::Span();
+    TraceBench::BareCapture();
+    TraceBench::WriteChromeJSON();
+    TraceBench::WriteBinary();
+
+    std::cout << std::endl;
+    LeapBench::BatchEpochNSecs();
+    LeapBench::BatchTime();
+    LeapBench::CursorTaiToUtc();
+    LeapBench::Uncached();
+
     std::cout << std::endl;
     NakedTmBench::EventCapture();
     NakedTimeSpec::EventCapture();
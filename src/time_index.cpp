@@ -0,0 +1,69 @@
+//
+// timeIndex: Maintain, and query, the sparse time index of a log file.
+//
+#include <util_time_log_index.h>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace nstimestamp;
+
+namespace {
+    int Usage() {
+        std::cerr << "Usage: timeIndex update <log> [stride]" << std::endl;
+        std::cerr << "       timeIndex query <log> <from> <to>" << std::endl;
+        std::cerr << std::endl;
+        std::cerr << "  update: Index any lines appended to log (creating the index if required)" << std::endl;
+        std::cerr << "  query:  Update the index, and print lines with timestamps in [from, to)" << std::endl;
+        std::cerr << std::endl;
+        std::cerr << "  Timestamps may be in either of the forms:" << std::endl;
+        std::cerr << "      YYYYMMDD HH:MM:SS.MMMUUUNNN" << std::endl;
+        std::cerr << "      YYYY-MM-DDTHH:MM:SS.UUUUUUZ" << std::endl;
+        return 1;
+    }
+
+    int Update(const std::string& log, size_t stride) {
+        LogTimeIndex index(log, stride);
+        if (!index.Update()) {
+            std::cerr << "Failed to update the index of " << log << std::endl;
+            return 1;
+        }
+        std::cout << "Indexed " << index.IndexedLines() << " lines ("
+                  << index.IndexedBytes() << " bytes) with "
+                  << index.Entries().size() << " entries: "
+                  << index.SidecarPath() << std::endl;
+        return 0;
+    }
+
+    int Query(const std::string& log, const Time& from, const Time& to) {
+        LogTimeIndex index(log);
+        if (!index.Update()) {
+            std::cerr << "Failed to update the index of " << log << std::endl;
+            return 1;
+        }
+        index.ForEachLine(from, to, [] (const char* line, size_t len) -> void {
+            fwrite(line, 1, len, stdout);
+            fputc('\n', stdout);
+        });
+        return 0;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        return Usage();
+    }
+
+    const std::string command = argv[1];
+    const std::string log = argv[2];
+    if (command == "update" && argc <= 4) {
+        const size_t stride = (argc == 4) ? strtoul(argv[3], nullptr, 10)
+                                          : LogTimeIndex::DEFAULT_STRIDE;
+        return Update(log, stride);
+    } else if (command == "query" && argc == 5) {
+        return Query(log, Time(argv[3]), Time(argv[4]));
+    } else {
+        return Usage();
+    }
+}
@@ -1,4 +1,6 @@
 #include "util_time.h"
+#include "util_time_inl.h"
+#include "util_time_format.h"
 #include <ctime>
 #include <sstream>
 #include <iomanip>
@@ -12,36 +14,57 @@ using namespace nstimestamp;
 const char* Time::EpochTimestamp =  "19700101 00:00:00.000000000";
 
 namespace {
-    const time_t& get_epoch() {
-        thread_local time_t epoch;
-        thread_local bool initialised = false;
-
-        if (!initialised) {
-            struct tm epoch_tm;
-            epoch_tm.tm_sec = 0;
-            epoch_tm.tm_min = 0;
-            epoch_tm.tm_hour= 0;
-            epoch_tm.tm_mday= 1;
-            epoch_tm.tm_mon=0;
-            epoch_tm.tm_year=70;
-            epoch_tm.tm_isdst=0;
-            epoch_tm.tm_gmtoff = 0;
-
-            epoch = timegm(&epoch_tm);
-
-            initialised = true;
-        }
+    const long SECS_PER_DAY = 86400;
 
-        return epoch;
+    /**
+     * Seconds since the Epoch of a broken down UTC time.
+     *
+     * Unlike timegm / gmtime_r this takes no locks (glibc serialises both on
+     * the process-wide timezone lock), so that threads parsing timestamps do
+     * not contend. As with timegm, out of range fields are normalised: e.g.
+     * the 0th day of a month is the last day of the previous month.
+     */
+    long EpochSecsFromTm(const tm& time) {
+        const long years = time_detail::FloorDiv(time.tm_mon, 12);
+        const long days = format_detail::DaysFromCivil(
+                              1900L + time.tm_year + years,
+                              static_cast<unsigned>(time.tm_mon - years * 12) + 1,
+                              1) + time.tm_mday - 1;
+        return days * SECS_PER_DAY +
+               time.tm_hour * 3600L + time.tm_min * 60L + time.tm_sec;
     }
-}
 
-Time::Time() {
-    SetNow();
-}
+    // The inverse of EpochSecsFromTm
+    void TmFromEpochSecs(long secs, tm& time) {
+        const long days = time_detail::FloorDiv(secs, SECS_PER_DAY);
+        const long daySecs = secs - days * SECS_PER_DAY;
+        long year = 0;
+        unsigned month = 0, mday = 0;
+        format_detail::CivilFromDays(days, year, month, mday);
+
+        time.tm_year = year - 1900;
+        time.tm_mon = month - 1;
+        time.tm_mday = mday;
+        time.tm_hour = daySecs / 3600;
+        time.tm_min = (daySecs / 60) % 60;
+        time.tm_sec = daySecs % 60;
+    }
 
-Time::Time(const Time& rhs) {
-    (*this) = rhs;
+    /**
+     * Normalising would roll 23:59:60 over into the next day: instead hold the
+     * leap second as 23:59:59, plus an extra second of nano-seconds.
+     *
+     * UTC leap seconds only occur at 23:59:60: any other :60 is normalised
+     * into the following minute.
+     */
+    bool ToLeapSecond(tm& working, timespec& ts) {
+        if (working.tm_sec != 60 || working.tm_hour != 23 || working.tm_min != 59) {
+            return false;
+        }
+        working.tm_sec = 59;
+        ts.tv_nsec += time_detail::NS_PER_SEC;
+        return true;
+    }
 }
 
 Time::Time(const std::string& timestamp) {
@@ -52,23 +75,6 @@ Time::Time(const char* timestamp) {
     (*this) = timestamp;
 }
 
-Time::Time(const struct timeval& tv) {
-    (*this) = tv;
-}
-
-Time& Time::operator=(const struct timeval& tv) {
-    ts.tv_sec = tv.tv_sec;
-    ts.tv_nsec = tv.tv_usec * 1000;
-    data.ready = false;
-    return *this;
-}
-
-Time& Time::operator=(const Time& rhs) {
-    this->ts = rhs.ts;
-    data.ready = false;
-    return *this;
-}
-
 Time& Time::operator=(const std::string& timestamp) {
     InitialiseFromString(timestamp.c_str(),timestamp.length());
     return *this;
@@ -123,8 +129,6 @@ void Time::InitialiseFromTimestamp(char* buf, const size_t len)
     epoch.tm_year=70;
     epoch.tm_isdst=0;
     epoch.tm_gmtoff = 0;
-    //epoch.tm_wday: Not used by timegm
-    //epoch.tm_yday: Not used by timegm
     working = epoch;
 
     /*
@@ -177,8 +181,10 @@ void Time::InitialiseFromTimestamp(char* buf, const size_t len)
      * calculate timeval...
      * --------------------
      */   
-    ts.tv_sec = difftime(timegm(&working),get_epoch());
-    SetTM(working);
+    ToLeapSecond(working, ts);
+    ts.tv_sec = EpochSecsFromTm(working);
+    // Normalise the fields (and restore any leap second) from the result
+    SetTmFromTimeval();
 }
 
 void Time::InitialiseFromISOTimestamp(char* buf)
@@ -196,8 +202,6 @@ void Time::InitialiseFromISOTimestamp(char* buf)
     epoch.tm_year=70;
     epoch.tm_isdst=0;
     epoch.tm_gmtoff = 0;
-    //epoch.tm_wday: Not used by timegm
-    //epoch.tm_yday: Not used by timegm
     working = epoch;
 
     /*
@@ -246,8 +250,10 @@ void Time::InitialiseFromISOTimestamp(char* buf)
      * calculate timeval...
      * --------------------
      */
-    ts.tv_sec = difftime(timegm(&working),get_epoch());
-    SetTM(working);
+    ToLeapSecond(working, ts);
+    ts.tv_sec = EpochSecsFromTm(working);
+    // Normalise the fields (and restore any leap second) from the result
+    SetTmFromTimeval();
 }
 
 void Time::InitialiseBlank()
@@ -261,20 +267,12 @@ void Time::InitialiseBlank()
     epoch.tm_year=70;
     epoch.tm_isdst=0;
     epoch.tm_gmtoff = 0;
-    //epoch.tm_wday: Not used by timegm
-    //epoch.tm_yday: Not used by timegm
     SetTM(epoch);
 
-    ts.tv_sec = difftime(get_epoch(),get_epoch());
+    ts.tv_sec = 0;
     ts.tv_nsec =  0;
 }
 
-Time& Time::SetNow() {
-    clock_gettime(CLOCK_REALTIME, &ts);
-    data.ready = false;
-    return *this;
-}
-
 void Time::MakeReady() const {
     if ( !data.ready) {
         data.ready = true;
@@ -284,7 +282,10 @@ void Time::MakeReady() const {
 
 void Time::SetTmFromTimeval() const {
     tm buf;
-    gmtime_r(&ts.tv_sec,&buf);
+    TmFromEpochSecs(ts.tv_sec, buf);
+    if (IsLeapSecond()) {
+        buf.tm_sec += 1;
+    }
     SetTM(buf);
 }
 
@@ -326,42 +327,6 @@ string Time::Timestamp() const {
     return strtime.str();
 }
 
-int Time::DiffSecs(const Time& rhs) const {
-    int diff = (ts.tv_sec - rhs.ts.tv_sec);
-    if ( ts.tv_nsec < rhs.ts.tv_nsec) {
-        diff-=1;
-    }
-    return diff;
-}
-long Time::DiffUSecs(const Time& rhs) const {
-    long diff = (  static_cast<long>(ts.tv_sec) -
-                   static_cast<long>(rhs.ts.tv_sec)
-                )*1000000;
-    diff+=((ts.tv_nsec - rhs.ts.tv_nsec) / 1000);
-    return diff;
-}
-
-long Time::DiffNSecs(const Time& rhs) const {
-    long diff = (  static_cast<long>(ts.tv_sec) -
-                   static_cast<long>(rhs.ts.tv_sec)
-                )*1000000000;
-    diff+=(ts.tv_nsec - rhs.ts.tv_nsec);
-    return diff;
-}
-
-long Time::EpochUSecs() const {
-    return ts.tv_nsec / 1000 + 1e6L* (long(ts.tv_sec));
-}
-
-long Time::EpochNSecs() const {
-    return ts.tv_nsec + 1e9L* (long(ts.tv_sec));
-}
-
-
-int Time::EpochSecs() const {
-    return ts.tv_sec;
-}
-
 void Time::SetTM(const tm &time) const {
     data.tm_sec = time.tm_sec;
     data.tm_min = time.tm_min;
@@ -0,0 +1,23 @@
+/**
+ * (c) Luke Humphreys 2017
+ *
+ * Internal: raw clock reads, for paths which need only the epoch-ns value.
+ */
+#ifndef __ELF_64_UTIL_TIME_CLOCK__
+#define __ELF_64_UTIL_TIME_CLOCK__
+
+#include "util_time.h"
+#include <ctime>
+
+namespace nstimestamp {
+
+// CLOCK_REALTIME, as nano-seconds since the epoch
+inline long RealtimeNSecs() {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec * time_detail::NS_PER_SEC + ts.tv_nsec;
+}
+
+}
+
+#endif
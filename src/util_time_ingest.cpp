@@ -0,0 +1,241 @@
+#include "util_time_ingest.h"
+#include "util_time_lines.h"
+#include "util_time_mapped_file.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+using namespace std;
+using namespace nstimestamp;
+
+namespace {
+    /**
+     * A new-line aligned section of the input: [begin, end).
+     *
+     * firstLine is the index (in the output) of the chunk's first line.
+     */
+    struct Chunk {
+        size_t begin;
+        size_t end;
+        size_t lines;
+        size_t firstLine;
+    };
+
+    /**
+     * Work-stealing execution of tasks [0, count).
+     *
+     * Each worker starts with a contiguous block of tasks, which it consumes
+     * from the front. Once exhausted, it steals from the back of the other
+     * workers' blocks. A block is stored as a single 64-bit word
+     *
+     *     | 63 .. 32 | 31 .. 0 |
+     *     |  front   |  back   |
+     *
+     * so that both the owner and thieves claim a task with a single CAS.
+     * This limits the pool to MAX_TASKS tasks: see ChunkBytesFor.
+     */
+    class WorkStealingPool {
+    public:
+        static const size_t MAX_TASKS = UINT32_MAX;
+
+        WorkStealingPool(size_t workers, size_t count)
+            : workers(std::max<size_t>(1, std::min(workers, count))),
+              queues(new Queue[this->workers])
+        {
+            for (size_t w = 0; w < this->workers; ++w) {
+                const uint64_t front = count * w / this->workers;
+                const uint64_t back = count * (w + 1) / this->workers;
+                queues[w].tasks.store(Pack(front, back), std::memory_order_relaxed);
+            }
+        }
+
+        /**
+         * Run task(i) for every task, returning once all are complete.
+         */
+        template <class Task>
+        void Run(Task task) {
+            std::vector<std::thread> threads;
+            for (size_t w = 1; w < workers; ++w) {
+                threads.emplace_back([this, w, &task] () -> void {
+                    Work(w, task);
+                });
+            }
+            Work(0, task);
+            for (std::thread& thread: threads) {
+                thread.join();
+            }
+        }
+
+    private:
+        struct alignas(64) Queue {
+            std::atomic<uint64_t> tasks;
+        };
+
+        static uint64_t Pack(uint64_t front, uint64_t back) {
+            return (front << 32) | back;
+        }
+
+        static uint32_t Front(uint64_t tasks) {
+            return static_cast<uint32_t>(tasks >> 32);
+        }
+
+        static uint32_t Back(uint64_t tasks) {
+            return static_cast<uint32_t>(tasks);
+        }
+
+        bool PopFront(size_t w, size_t& task) {
+            uint64_t tasks = queues[w].tasks.load(std::memory_order_relaxed);
+            while (Front(tasks) < Back(tasks)) {
+                if (queues[w].tasks.compare_exchange_weak(
+                        tasks, Pack(Front(tasks) + 1, Back(tasks))))
+                {
+                    task = Front(tasks);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool PopBack(size_t w, size_t& task) {
+            uint64_t tasks = queues[w].tasks.load(std::memory_order_relaxed);
+            while (Front(tasks) < Back(tasks)) {
+                if (queues[w].tasks.compare_exchange_weak(
+                        tasks, Pack(Front(tasks), Back(tasks) - 1)))
+                {
+                    task = Back(tasks) - 1;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        template <class Task>
+        void Work(size_t w, Task& task) {
+            size_t next = 0;
+            for (;;) {
+                if (PopFront(w, next)) {
+                    task(next);
+                    continue;
+                }
+
+                // Nothing left locally: try to steal from the other workers
+                bool stolen = false;
+                for (size_t i = 1; i < workers && !stolen; ++i) {
+                    stolen = PopBack((w + i) % workers, next);
+                }
+                if (!stolen) {
+                    // No queue ever grows: there is no more work to be found
+                    return;
+                }
+                task(next);
+            }
+        }
+
+        const size_t workers;
+        std::unique_ptr<Queue[]> queues;
+    };
+
+    const size_t WorkStealingPool::MAX_TASKS;
+
+    /**
+     * The chunk size to use for size bytes of input: at least chunkBytes,
+     * but large enough that the input splits into no more chunks than the
+     * pool can hold. Every chunk other than the last is at least this size.
+     */
+    size_t ChunkBytesFor(size_t size, size_t chunkBytes) {
+        const size_t minimum = size / WorkStealingPool::MAX_TASKS + 1;
+        return std::max(chunkBytes, minimum);
+    }
+
+    /**
+     * Split the input into chunks of (at least) chunkBytes, extended to the
+     * end of the line.
+     */
+    void Split(const char* data,
+               size_t size,
+               size_t chunkBytes,
+               std::vector<Chunk>& chunks)
+    {
+        size_t begin = 0;
+        while (begin < size) {
+            size_t end = std::min(size, begin + chunkBytes);
+            if (end < size) {
+                const char* eol = static_cast<const char*>(
+                    memchr(data + end - 1, '\n', size - end + 1));
+                end = eol ? (eol - data + 1) : size;
+            }
+            chunks.push_back({begin, end, 0, 0});
+            begin = end;
+        }
+    }
+
+    size_t CountLines(const char* data, const Chunk& chunk) {
+        size_t lines = std::count(data + chunk.begin, data + chunk.end, '\n');
+        // An unterminated final line
+        if (data[chunk.end - 1] != '\n') {
+            ++lines;
+        }
+        return lines;
+    }
+
+    void ParseLines(const char* data, const Chunk& chunk, long* out) {
+        size_t offset = chunk.begin;
+        while (offset < chunk.end) {
+            const char* line = data + offset;
+            const char* eol = static_cast<const char*>(
+                memchr(line, '\n', chunk.end - offset));
+            const size_t len = eol ? (eol - line) : (chunk.end - offset);
+            *out = LineEpochNSecs(line, len);
+            ++out;
+            offset += len + 1;
+        }
+    }
+}
+
+const size_t TimestampIngest::DEFAULT_CHUNK_BYTES;
+
+TimestampIngest::TimestampIngest(size_t threads, size_t chunkBytes)
+    : threads(threads > 0 ? threads
+                          : std::max<size_t>(1, std::thread::hardware_concurrency())),
+      chunkBytes(std::max<size_t>(chunkBytes, 1))
+{
+}
+
+bool TimestampIngest::Ingest(const std::string& path, std::vector<long>& epochNs) const {
+    epochNs.clear();
+    MappedFile file(path);
+    if (!file.IsOpen()) {
+        return false;
+    }
+    Ingest(file.Data(), file.Size(), epochNs);
+    return true;
+}
+
+void TimestampIngest::Ingest(const char* data,
+                             size_t size,
+                             std::vector<long>& epochNs) const
+{
+    std::vector<Chunk> chunks;
+    Split(data, size, ChunkBytesFor(size, chunkBytes), chunks);
+
+    // Pass 1: Size the output
+    WorkStealingPool(threads, chunks.size()).Run([&] (size_t i) -> void {
+        chunks[i].lines = CountLines(data, chunks[i]);
+    });
+
+    size_t lines = 0;
+    for (Chunk& chunk: chunks) {
+        chunk.firstLine = lines;
+        lines += chunk.lines;
+    }
+    epochNs.resize(lines);
+
+    // Pass 2: Parse each line into its slot
+    long* out = epochNs.data();
+    WorkStealingPool(threads, chunks.size()).Run([&] (size_t i) -> void {
+        ParseLines(data, chunks[i], out + chunks[i].firstLine);
+    });
+}
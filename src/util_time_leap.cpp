@@ -0,0 +1,206 @@
+#include "util_time_leap.h"
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+
+using namespace std;
+using namespace nstimestamp;
+
+namespace {
+    using time_detail::NS_PER_SEC;
+    using time_detail::FloorDiv;
+
+    // Seconds between the NTP epoch (1900) used by leap-seconds.list, and 1970
+    const long NTP_TO_UNIX = 2208988800L;
+
+    /**
+     * IERS Bulletin C: UTC epoch second from which TAI - UTC applies
+     */
+    const struct {
+        long utcSecs;
+        long offset;
+    } BUILTIN[] = {
+        {  63072000, 10},   // 1 Jan 1972
+        {  78796800, 11},   // 1 Jul 1972
+        {  94694400, 12},   // 1 Jan 1973
+        { 126230400, 13},   // 1 Jan 1974
+        { 157766400, 14},   // 1 Jan 1975
+        { 189302400, 15},   // 1 Jan 1976
+        { 220924800, 16},   // 1 Jan 1977
+        { 252460800, 17},   // 1 Jan 1978
+        { 283996800, 18},   // 1 Jan 1979
+        { 315532800, 19},   // 1 Jan 1980
+        { 362793600, 20},   // 1 Jul 1981
+        { 394329600, 21},   // 1 Jul 1982
+        { 425865600, 22},   // 1 Jul 1983
+        { 489024000, 23},   // 1 Jul 1985
+        { 567993600, 24},   // 1 Jan 1988
+        { 631152000, 25},   // 1 Jan 1990
+        { 662688000, 26},   // 1 Jan 1991
+        { 709948800, 27},   // 1 Jul 1992
+        { 741484800, 28},   // 1 Jul 1993
+        { 773020800, 29},   // 1 Jul 1994
+        { 820454400, 30},   // 1 Jan 1996
+        { 867715200, 31},   // 1 Jul 1997
+        { 915148800, 32},   // 1 Jan 1999
+        {1136073600, 33},   // 1 Jan 2006
+        {1230768000, 34},   // 1 Jan 2009
+        {1341100800, 35},   // 1 Jul 2012
+        {1435708800, 36},   // 1 Jul 2015
+        {1483228800, 37},   // 1 Jan 2017
+    };
+}
+
+const char* const LeapSeconds::SYSTEM_LIST = "/usr/share/zoneinfo/leap-seconds.list";
+
+LeapSeconds::LeapSeconds() {
+    for (const auto& entry: BUILTIN) {
+        entries.push_back({entry.utcSecs * NS_PER_SEC, entry.offset * NS_PER_SEC});
+    }
+}
+
+bool LeapSeconds::Load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    /*
+     * Each non-comment line is of the form:
+     *     <NTP seconds> <TAI - UTC> [# comment]
+     */
+    std::vector<Entry> loaded;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.find_first_not_of(" \t\r") == std::string::npos || line[0] == '#') {
+            continue;
+        }
+        char* end = nullptr;
+        const long ntpSecs = strtol(line.c_str(), &end, 10);
+        const char* next = end;
+        const long offset = strtol(next, &end, 10);
+        if (next == line.c_str() || end == next) {
+            return false;
+        }
+
+        const Entry entry = {(ntpSecs - NTP_TO_UNIX) * NS_PER_SEC, offset * NS_PER_SEC};
+        if (!loaded.empty()) {
+            const Entry& last = loaded.back();
+            // Only (single) positive leap seconds are supported
+            if (entry.utcNs <= last.utcNs || entry.offsetNs != last.offsetNs + NS_PER_SEC) {
+                return false;
+            }
+        }
+        loaded.push_back(entry);
+    }
+
+    if (loaded.empty()) {
+        return false;
+    }
+    entries.swap(loaded);
+    return true;
+}
+
+int LeapSeconds::TaiOffset(const Time& utc) const {
+    Cursor cursor(*this);
+    return (cursor.UtcToTai(utc) - utc.EpochNSecs()) / NS_PER_SEC;
+}
+
+long LeapSeconds::UtcToTai(const Time& utc) const {
+    return Cursor(*this).UtcToTai(utc);
+}
+
+Time LeapSeconds::TaiToUtc(long taiNs) const {
+    return Cursor(*this).TaiToUtc(taiNs);
+}
+
+void LeapSeconds::UtcToTai(const Time* utc, long* taiNs, size_t count) const {
+    Cursor cursor(*this);
+    for (size_t i = 0; i < count; ++i) {
+        taiNs[i] = cursor.UtcToTai(utc[i]);
+    }
+}
+
+void LeapSeconds::UtcToTai(const long* utcNs, long* taiNs, size_t count) const {
+    Cursor cursor(*this);
+    for (size_t i = 0; i < count; ++i) {
+        taiNs[i] = cursor.UtcToTai(utcNs[i]);
+    }
+}
+
+int LeapSeconds::DiffSecs(const Time& lhs, const Time& rhs) const {
+    return FloorDiv(DiffNSecs(lhs, rhs), NS_PER_SEC);
+}
+
+long LeapSeconds::DiffUSecs(const Time& lhs, const Time& rhs) const {
+    return DiffNSecs(lhs, rhs) / 1000;
+}
+
+long LeapSeconds::DiffNSecs(const Time& lhs, const Time& rhs) const {
+    Cursor cursor(*this);
+    return cursor.UtcToTai(lhs) - cursor.UtcToTai(rhs);
+}
+
+LeapSeconds::Cursor::Cursor(const LeapSeconds& table)
+    : table(table)
+{
+    Select(table.entries.size() - 1);
+}
+
+Time LeapSeconds::Cursor::TaiToUtc(long taiNs) {
+    if (taiNs < taiFrom || taiNs >= taiTo) {
+        SeekTai(taiNs);
+    }
+    const long utcNs = taiNs - offsetNs;
+
+    if (utcNs >= utcTo) {
+        // The leap second ending the span: hold as 23:59:60
+        timespec ts;
+        ts.tv_sec = utcTo / NS_PER_SEC - 1;
+        ts.tv_nsec = utcNs - ts.tv_sec * NS_PER_SEC;
+        return Time(ts);
+    }
+    return Time::FromEpochNSecs(utcNs);
+}
+
+void LeapSeconds::Cursor::SeekUtc(long utcNs) {
+    const std::vector<Entry>& entries = table.entries;
+    const auto next = std::upper_bound(
+        entries.begin() + 1, entries.end(), utcNs,
+        [] (long ns, const Entry& entry) -> bool { return ns < entry.utcNs; });
+    Select(next - entries.begin() - 1);
+}
+
+void LeapSeconds::Cursor::SeekTai(long taiNs) {
+    // Each span's TAI range starts once its leap second has passed
+    const std::vector<Entry>& entries = table.entries;
+    const auto next = std::upper_bound(
+        entries.begin() + 1, entries.end(), taiNs,
+        [] (long ns, const Entry& entry) -> bool { return ns < entry.utcNs + entry.offsetNs; });
+    Select(next - entries.begin() - 1);
+}
+
+void LeapSeconds::Cursor::Select(size_t index) {
+    const std::vector<Entry>& entries = table.entries;
+    const Entry& entry = entries[index];
+    offsetNs = entry.offsetNs;
+
+    // The first offset also applies before the table
+    if (index == 0) {
+        utcFrom = LONG_MIN;
+        taiFrom = LONG_MIN;
+    } else {
+        utcFrom = entry.utcNs;
+        taiFrom = entry.utcNs + entry.offsetNs;
+    }
+
+    if (index + 1 == entries.size()) {
+        utcTo = LONG_MAX;
+        taiTo = LONG_MAX;
+    } else {
+        const Entry& next = entries[index + 1];
+        utcTo = next.utcNs;
+        taiTo = next.utcNs + next.offsetNs;
+    }
+}
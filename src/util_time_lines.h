@@ -0,0 +1,35 @@
+/**
+ * (c) Luke Humphreys 2017
+ *
+ * Internal: timestamps at the start of (non null-terminated) lines.
+ */
+#ifndef __ELF_64_UTIL_TIME_LINES__
+#define __ELF_64_UTIL_TIME_LINES__
+
+#include "util_time.h"
+#include <algorithm>
+#include <cstring>
+
+namespace nstimestamp {
+
+/**
+ * Parse the timestamp at the start of line, with the same semantics as
+ * Time::InitialiseFromString: garbage produces a (meaningless) value, and
+ * too short a line produces the Epoch.
+ */
+inline long LineEpochNSecs(const char* line, size_t len) {
+    // InitialiseFromString requires null termination: take a bounded copy
+    char buf[28];
+    const size_t stampLen = std::min<size_t>(len, 27);
+    memcpy(buf, line, stampLen);
+    buf[stampLen] = '\0';
+
+    const timespec epoch = {0, 0};
+    Time stamp(epoch);
+    stamp.InitialiseFromString(buf, stampLen);
+    return stamp.EpochNSecs();
+}
+
+}
+
+#endif
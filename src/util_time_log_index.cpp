@@ -0,0 +1,307 @@
+#include "util_time_log_index.h"
+#include "util_time_lines.h"
+#include "util_time_mapped_file.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace nstimestamp;
+
+namespace {
+    const char SIDECAR_MAGIC[8] = {'N', 'S', 'T', 'I', 'D', 'X', '0', '2'};
+
+    // Longest prefix of the first line included in the fingerprint
+    const uint64_t MAX_HEAD_BYTES = 4096;
+
+    /**
+     * Sidecar layout:
+     *     SidecarHeader
+     *     LogTimeIndex::Entry[entries]
+     *
+     * New entries are appended before the header is re-written, so that an
+     * interrupted update leaves a valid (if out of date) index.
+     *
+     * The fingerprint (hashes of the first, and last, indexed lines) detects
+     * a log which has been replaced in place: truncated and re-grown (e.g.
+     * logrotate's copytruncate), or re-created with a re-used inode.
+     */
+    struct SidecarHeader {
+        char     magic[8];
+        uint64_t stride;
+        uint64_t inode;
+        uint64_t indexedBytes;
+        uint64_t indexedLines;
+        uint64_t entries;
+        uint64_t headBytes;
+        uint64_t headHash;
+        uint64_t tailOffset;
+        uint64_t tailHash;
+    };
+
+    // FNV-1a
+    uint64_t Hash(const char* data, uint64_t len) {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (uint64_t i = 0; i < len; ++i) {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+    /**
+     * Extract the timestamp at the start of a log line.
+     *
+     * Returns false if the line does not start with a timestamp.
+     */
+    bool ParseLineTime(const char* line, size_t len, long& epochNs) {
+        // Time requires at least 24 characters
+        if (len < 24 || line[0] < '0' || line[0] > '9') {
+            return false;
+        }
+
+        epochNs = LineEpochNSecs(line, len);
+        return true;
+    }
+
+    /**
+     * Iterate over the lines of the mapped file, starting at offset.
+     *
+     * visit(lineOffset, line, len) returns false to stop the iteration.
+     */
+    template <class Visit>
+    void ForEachLineFrom(const MappedFile& log, uint64_t offset, Visit visit) {
+        const char* data = log.Data();
+        const uint64_t size = log.Size();
+        while (offset < size) {
+            const char* line = data + offset;
+            const char* eol = static_cast<const char*>(
+                memchr(line, '\n', size - offset));
+            const size_t len = eol ? (eol - line) : (size - offset);
+            if (!visit(offset, line, len)) {
+                return;
+            }
+            offset += len + 1;
+        }
+    }
+
+    /**
+     * The first line, at or after offset, whose timestamp is at, or after,
+     * epochNs.
+     */
+    uint64_t ScanFor(const MappedFile& log, uint64_t offset, long epochNs) {
+        uint64_t found = log.Size();
+        ForEachLineFrom(log, offset, [&] (uint64_t lineOffset, const char* line, size_t len) -> bool {
+            long lineNs = 0;
+            if (ParseLineTime(line, len, lineNs) && lineNs >= epochNs) {
+                found = lineOffset;
+                return false;
+            }
+            return true;
+        });
+        return found;
+    }
+}
+
+const size_t LogTimeIndex::DEFAULT_STRIDE;
+
+LogTimeIndex::LogTimeIndex(const std::string& logPath, size_t stride)
+    : logPath(logPath),
+      sidecarPath(SidecarPath(logPath)),
+      stride(std::max<size_t>(stride, 1)),
+      inode(0),
+      indexedBytes(0),
+      indexedLines(0),
+      headBytes(0),
+      headHash(0),
+      tailOffset(0),
+      tailHash(0)
+{
+    Load();
+}
+
+std::string LogTimeIndex::SidecarPath(const std::string& logPath) {
+    return logPath + ".tidx";
+}
+
+void LogTimeIndex::Reset() {
+    inode = 0;
+    indexedBytes = 0;
+    indexedLines = 0;
+    headBytes = 0;
+    headHash = 0;
+    tailOffset = 0;
+    tailHash = 0;
+    entries.clear();
+}
+
+void LogTimeIndex::Load() {
+    const int fd = open(sidecarPath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+
+    SidecarHeader header;
+    struct stat info;
+    const bool valid =
+        fstat(fd, &info) == 0 &&
+        pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+        memcmp(header.magic, SIDECAR_MAGIC, sizeof(SIDECAR_MAGIC)) == 0 &&
+        header.stride > 0 &&
+        static_cast<uint64_t>(info.st_size) >=
+            sizeof(header) + header.entries * sizeof(Entry);
+
+    if (valid) {
+        entries.resize(header.entries);
+        const ssize_t bytes = entries.size() * sizeof(Entry);
+        if (bytes == 0 || pread(fd, entries.data(), bytes, sizeof(header)) == bytes) {
+            stride = header.stride;
+            inode = header.inode;
+            indexedBytes = header.indexedBytes;
+            indexedLines = header.indexedLines;
+            headBytes = header.headBytes;
+            headHash = header.headHash;
+            tailOffset = header.tailOffset;
+            tailHash = header.tailHash;
+        } else {
+            Reset();
+        }
+    }
+    close(fd);
+}
+
+bool LogTimeIndex::Update() {
+    MappedFile log(logPath);
+    if (!log.IsOpen()) {
+        return false;
+    }
+    log.AdviseSequential();
+
+    // The log has been rotated, truncated, or replaced: start again
+    const bool rebuild = (log.Inode() != inode || !Matches(log));
+    if (rebuild) {
+        Reset();
+        inode = log.Inode();
+    }
+
+    const size_t firstNewEntry = entries.size();
+    const uint64_t size = log.Size();
+    ForEachLineFrom(log, indexedBytes, [&] (uint64_t offset, const char* line, size_t len) -> bool {
+        if (offset + len >= size) {
+            // Incomplete line: still being written
+            return false;
+        }
+        long epochNs = 0;
+        if (indexedLines % stride == 0 && ParseLineTime(line, len, epochNs)) {
+            entries.push_back({epochNs, offset});
+        }
+        ++indexedLines;
+        tailOffset = offset;
+        indexedBytes = offset + len + 1;
+        return true;
+    });
+
+    if (indexedBytes > 0) {
+        const char* data = log.Data();
+        const uint64_t headLimit = std::min(indexedBytes, MAX_HEAD_BYTES);
+        const char* eol = static_cast<const char*>(memchr(data, '\n', headLimit));
+        headBytes = eol ? (eol - data + 1) : headLimit;
+        headHash = Hash(data, headBytes);
+        tailHash = Hash(data + tailOffset, indexedBytes - tailOffset);
+    }
+
+    return Save(firstNewEntry, rebuild);
+}
+
+bool LogTimeIndex::Save(size_t firstNewEntry, bool rebuild) const {
+    int flags = O_WRONLY | O_CREAT;
+    if (rebuild) {
+        flags |= O_TRUNC;
+    }
+    const int fd = open(sidecarPath.c_str(), flags, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    SidecarHeader header;
+    memcpy(header.magic, SIDECAR_MAGIC, sizeof(SIDECAR_MAGIC));
+    header.stride = stride;
+    header.inode = inode;
+    header.indexedBytes = indexedBytes;
+    header.indexedLines = indexedLines;
+    header.entries = entries.size();
+    header.headBytes = headBytes;
+    header.headHash = headHash;
+    header.tailOffset = tailOffset;
+    header.tailHash = tailHash;
+
+    const ssize_t newBytes = (entries.size() - firstNewEntry) * sizeof(Entry);
+    const off_t newOffset = sizeof(header) + firstNewEntry * sizeof(Entry);
+    bool ok = newBytes == 0 ||
+              pwrite(fd, entries.data() + firstNewEntry, newBytes, newOffset) == newBytes;
+    ok = ok && pwrite(fd, &header, sizeof(header), 0) == sizeof(header);
+
+    return (close(fd) == 0) && ok;
+}
+
+bool LogTimeIndex::Matches(const MappedFile& log) const {
+    if (log.Size() < indexedBytes) {
+        return false;
+    }
+    if (indexedBytes == 0) {
+        return true;
+    }
+    return Hash(log.Data(), headBytes) == headHash &&
+           Hash(log.Data() + tailOffset, indexedBytes - tailOffset) == tailHash;
+}
+
+uint64_t LogTimeIndex::ScanStart(long epochNs) const {
+    // The last indexed line strictly before epochNs
+    auto it = std::lower_bound(entries.begin(), entries.end(), epochNs,
+                               [] (const Entry& entry, long ns) -> bool {
+                                   return entry.epochNs < ns;
+                               });
+    return (it == entries.begin()) ? 0 : (it - 1)->offset;
+}
+
+LogTimeIndex::Range LogTimeIndex::Find(const MappedFile& log,
+                                       const Time& from,
+                                       const Time& to) const
+{
+    // A stale index (the log was replaced since the last Update) is ignored:
+    // the whole log is scanned instead
+    const bool valid = Matches(log);
+
+    Range range;
+    range.begin = ScanFor(log, valid ? ScanStart(from.EpochNSecs()) : 0, from.EpochNSecs());
+    range.end = ScanFor(log,
+                        std::max(range.begin, valid ? ScanStart(to.EpochNSecs()) : 0),
+                        to.EpochNSecs());
+    return range;
+}
+
+LogTimeIndex::Range LogTimeIndex::Find(const Time& from, const Time& to) const {
+    MappedFile log(logPath);
+    return Find(log, from, to);
+}
+
+size_t LogTimeIndex::ForEachLine(
+        const Time& from,
+        const Time& to,
+        const std::function<void (const char* line, size_t len)>& callback) const
+{
+    MappedFile log(logPath);
+    const Range range = Find(log, from, to);
+    size_t lines = 0;
+    ForEachLineFrom(log, range.begin, [&] (uint64_t offset, const char* line, size_t len) -> bool {
+        if (offset >= range.end) {
+            return false;
+        }
+        callback(line, len);
+        ++lines;
+        return true;
+    });
+    return lines;
+}
@@ -0,0 +1,48 @@
+#include "util_time_mapped_file.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace nstimestamp;
+
+MappedFile::MappedFile(const std::string& path)
+    : open(false),
+      data(nullptr),
+      size(0),
+      inode(0)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat info;
+        if (fstat(fd, &info) == 0) {
+            inode = info.st_ino;
+            size = info.st_size;
+            if (size == 0) {
+                open = true;
+            } else {
+                void* addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+                if (addr != MAP_FAILED) {
+                    data = static_cast<const char*>(addr);
+                    open = true;
+                } else {
+                    size = 0;
+                }
+            }
+        }
+        close(fd);
+    }
+}
+
+MappedFile::~MappedFile() {
+    if (data) {
+        munmap(const_cast<char*>(data), size);
+    }
+}
+
+void MappedFile::AdviseSequential() const {
+    if (data) {
+        madvise(const_cast<char*>(data), size, MADV_SEQUENTIAL);
+    }
+}
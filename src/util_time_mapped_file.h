@@ -0,0 +1,48 @@
+/**
+ * (c) Luke Humphreys 2017
+ *
+ * Internal: read-only memory mapping of a file.
+ */
+#ifndef __ELF_64_UTIL_TIME_MAPPED_FILE__
+#define __ELF_64_UTIL_TIME_MAPPED_FILE__
+
+#include <cstddef>
+#include <string>
+
+namespace nstimestamp {
+
+class MappedFile {
+public:
+    /**
+     * Map the current contents of the file. An empty file is successfully
+     * opened, with a Size() of 0.
+     */
+    MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile& rhs) = delete;
+    MappedFile& operator=(const MappedFile& rhs) = delete;
+
+    bool IsOpen() const { return open; }
+
+    const char* Data() const { return data; }
+    size_t Size() const { return size; }
+
+    // Identity of the underlying file (used to detect log rotation)
+    unsigned long Inode() const { return inode; }
+
+    /**
+     * Hint to the kernel that the mapping will be read sequentially
+     */
+    void AdviseSequential() const;
+
+private:
+    bool          open;
+    const char*   data;
+    size_t        size;
+    unsigned long inode;
+};
+
+}
+
+#endif
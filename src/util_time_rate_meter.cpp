@@ -0,0 +1,170 @@
+#include "util_time_rate_meter.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+using namespace std;
+using namespace nstimestamp;
+
+namespace {
+    /*
+     * Each slot packs the bucket it is currently counting (the low 32 bits of
+     * its index) with the count itself:
+     *
+     *     | 63 .. 32 | 31 .. 0 |
+     *     |   tag    |  count  |
+     *
+     * allowing the pair to be reset and incremented with a single CAS.
+     */
+    inline uint32_t Tag(long bucket) {
+        return static_cast<uint32_t>(bucket);
+    }
+
+    inline uint32_t SlotTag(uint64_t value) {
+        return static_cast<uint32_t>(value >> 32);
+    }
+
+    inline uint32_t SlotCount(uint64_t value) {
+        return static_cast<uint32_t>(value);
+    }
+
+    inline uint64_t Pack(uint32_t tag, uint32_t count) {
+        return (static_cast<uint64_t>(tag) << 32) | count;
+    }
+
+    // Slots per cache-line
+    const size_t LINE_SLOTS = 64 / sizeof(uint64_t);
+
+    /**
+     * Threads are assigned shards round-robin, on their first write.
+     */
+    size_t ThreadShardId() {
+        static std::atomic<size_t> nextId(0);
+        thread_local size_t id = nextId.fetch_add(1, std::memory_order_relaxed);
+        return id;
+    }
+
+    size_t DefaultShards(size_t shards) {
+        if (shards == 0) {
+            shards = std::thread::hardware_concurrency();
+        }
+        return std::max<size_t>(shards, 1);
+    }
+}
+
+RateMeter::RateMeter(long bucketWidthNs, size_t buckets, size_t shards)
+    : bucketWidth(std::max(bucketWidthNs, 1L)),
+      // One additional bucket for the one currently being written
+      ringSize(std::max<size_t>(buckets, 1) + 1),
+      shards(DefaultShards(shards)),
+      // Pad each shard so that no two share a cache-line
+      shardStride(((ringSize + LINE_SLOTS - 1) / LINE_SLOTS + 1) * LINE_SLOTS),
+      slots(new Slot[this->shards * shardStride])
+{
+    for (size_t i = 0; i < this->shards * shardStride; ++i) {
+        slots[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void RateMeter::Record(uint32_t count) {
+    Record(Time(), count);
+}
+
+void RateMeter::Record(const Time& when, uint32_t count) {
+    const long bucket = BucketIndex(when);
+    const uint32_t tag = Tag(bucket);
+    Slot& slot = GetSlot(ThreadShardId() % shards, bucket);
+
+    uint64_t current = slot.load(std::memory_order_relaxed);
+    uint64_t next = 0;
+    do {
+        const uint32_t currentTag = SlotTag(current);
+        if (currentTag == tag) {
+            next = current + count;
+        } else if (static_cast<int32_t>(currentTag - tag) > 0 && current != 0) {
+            // The slot has already moved on to a later bucket
+            return;
+        } else {
+            next = Pack(tag, count);
+        }
+    } while (!slot.compare_exchange_weak(current,
+                                         next,
+                                         std::memory_order_relaxed));
+}
+
+uint64_t RateMeter::Count(const Time& now, size_t buckets) const {
+    const long current = BucketIndex(now);
+    buckets = std::min(buckets, Buckets());
+
+    uint64_t total = 0;
+    for (size_t i = 1; i <= buckets; ++i) {
+        total += BucketCount(current - static_cast<long>(i));
+    }
+    return total;
+}
+
+double RateMeter::Rate(const Time& now, size_t buckets) const {
+    buckets = std::min(buckets, Buckets());
+    if (buckets == 0) {
+        return 0;
+    }
+    const double window = 1e-9 * bucketWidth * buckets;
+    return Count(now, buckets) / window;
+}
+
+double RateMeter::PeakRate(const Time& now, size_t buckets) const {
+    const long current = BucketIndex(now);
+    buckets = std::min(buckets, Buckets());
+
+    uint64_t peak = 0;
+    for (size_t i = 1; i <= buckets; ++i) {
+        peak = std::max(peak, BucketCount(current - static_cast<long>(i)));
+    }
+    return peak / (1e-9 * bucketWidth);
+}
+
+double RateMeter::EWMARate(const Time& now, long timeConstantNs) const {
+    const long current = BucketIndex(now);
+    const double width = 1e-9 * bucketWidth;
+    const double alpha =
+        1.0 - std::exp(-static_cast<double>(bucketWidth) /
+                        std::max(timeConstantNs, 1L));
+
+    // Oldest to newest, seeding the average with the oldest bucket
+    double ewma = BucketCount(current - static_cast<long>(Buckets())) / width;
+    for (size_t i = Buckets() - 1; i >= 1; --i) {
+        const double rate = BucketCount(current - static_cast<long>(i)) / width;
+        ewma += alpha * (rate - ewma);
+    }
+    return ewma;
+}
+
+long RateMeter::BucketIndex(const Time& time) const {
+    const long ns = time.EpochNSecs();
+    long bucket = ns / bucketWidth;
+    if (ns < 0 && (ns % bucketWidth) != 0) {
+        --bucket;
+    }
+    return bucket;
+}
+
+uint64_t RateMeter::BucketCount(long bucket) const {
+    const uint32_t tag = Tag(bucket);
+    uint64_t total = 0;
+    for (size_t shard = 0; shard < shards; ++shard) {
+        const uint64_t value =
+            GetSlot(shard, bucket).load(std::memory_order_relaxed);
+        if (SlotTag(value) == tag) {
+            total += SlotCount(value);
+        }
+    }
+    return total;
+}
+
+RateMeter::Slot& RateMeter::GetSlot(size_t shard, long bucket) const {
+    long ringIdx = bucket % static_cast<long>(ringSize);
+    if (ringIdx < 0) {
+        ringIdx += ringSize;
+    }
+    return slots[shard * shardStride + static_cast<size_t>(ringIdx)];
+}
@@ -0,0 +1,283 @@
+#include "util_time_shared_clock.h"
+#include "util_time_clock.h"
+#include <atomic>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+using namespace std;
+using namespace nstimestamp;
+
+namespace nstimestamp {
+namespace shared_clock_detail {
+    /**
+     * The shared-memory layout.
+     *
+     * The parameters are protected by a seqlock: seq is odd whilst an update
+     * is in progress. All fields are atomics (accessed relaxed) so that a
+     * reader racing with the publisher is well defined; the seqlock tells the
+     * reader to discard any such torn read.
+     */
+    struct Segment {
+        std::atomic<uint64_t> magic;
+        std::atomic<uint64_t> seq;
+
+        std::atomic<uint64_t> baseCounter;
+        std::atomic<int64_t>  baseNs;
+        std::atomic<uint64_t> mult;
+        std::atomic<uint32_t> shift;
+        std::atomic<int64_t>  offsetNs;
+    };
+}
+}
+
+using shared_clock_detail::Segment;
+
+namespace {
+    // 64 x 64 bit products
+    __extension__ typedef __int128 int128;
+    __extension__ typedef unsigned __int128 uint128;
+
+    // "NSTCLK" + layout version
+    const uint64_t SEGMENT_MAGIC = 0x4e5354434c4b0001ULL;
+
+    const uint32_t CALIBRATION_SHIFT = 32;
+
+    using time_detail::NS_PER_SEC;
+
+    /**
+     * An update takes a handful of ns: a sequence which stays odd for this
+     * many reads belongs to a publisher which has died (or been de-scheduled)
+     * mid-update. Readers then use their last good parameters.
+     */
+    const size_t MAX_READ_ATTEMPTS = 10000;
+
+    /**
+     * Sample CLOCK_REALTIME, and the counter at the same instant.
+     *
+     * The realtime read is bracketed by two counter reads, the tightest of
+     * several attempts is used.
+     */
+    void Sample(uint64_t& counter, long& ns) {
+        uint64_t bestWidth = UINT64_MAX;
+        for (int i = 0; i < 10; ++i) {
+            const uint64_t before = ReadClockCounter();
+            const long sampleNs = RealtimeNSecs();
+            const uint64_t after = ReadClockCounter();
+            if (after - before < bestWidth) {
+                bestWidth = after - before;
+                counter = before + (after - before) / 2;
+                ns = sampleNs;
+            }
+        }
+    }
+
+    long ToEpochNSecs(const SharedClockParams& params, uint64_t counter) {
+        const int64_t delta = static_cast<int64_t>(counter - params.baseCounter);
+        const int128 scaled =
+            (static_cast<int128>(delta) * params.mult) >> params.shift;
+        return params.baseNs + params.offsetNs + static_cast<long>(scaled);
+    }
+
+    bool ReadParams(const Segment* segment, SharedClockParams& params) {
+        if (!segment ||
+            segment->magic.load(std::memory_order_acquire) != SEGMENT_MAGIC)
+        {
+            return false;
+        }
+
+        for (size_t attempt = 0; attempt < MAX_READ_ATTEMPTS; ++attempt) {
+            const uint64_t before = segment->seq.load(std::memory_order_acquire);
+            params.baseCounter = segment->baseCounter.load(std::memory_order_relaxed);
+            params.baseNs = segment->baseNs.load(std::memory_order_relaxed);
+            params.mult = segment->mult.load(std::memory_order_relaxed);
+            params.shift = segment->shift.load(std::memory_order_relaxed);
+            params.offsetNs = segment->offsetNs.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const uint64_t after = segment->seq.load(std::memory_order_relaxed);
+
+            if (before == after && (before & 1) == 0) {
+                // seq is 0 until the first publish completes
+                return before != 0;
+            }
+        }
+        return false;
+    }
+}
+
+uint64_t nstimestamp::ReadClockCounter() {
+#if defined(__x86_64__)
+    return __rdtsc();
+#else
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * NS_PER_SEC + ts.tv_nsec;
+#endif
+}
+
+/*
+ * Publisher
+ * ---------
+ */
+SharedClockPublisher::SharedClockPublisher(const std::string& name)
+    : name(name),
+      segment(nullptr)
+{
+    const int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd >= 0) {
+        if (ftruncate(fd, sizeof(Segment)) == 0) {
+            void* addr = mmap(nullptr,
+                              sizeof(Segment),
+                              PROT_READ | PROT_WRITE,
+                              MAP_SHARED,
+                              fd,
+                              0);
+            if (addr != MAP_FAILED) {
+                segment = static_cast<Segment*>(addr);
+                /*
+                 * A new segment is zero filled, but we may be re-opening an
+                 * existing one: preserve its sequence. An odd sequence left
+                 * by a previous publisher which died mid-update is left
+                 * alone: readers continue to reject the (torn) parameters
+                 * until the next Publish completes the update.
+                 */
+                segment->magic.store(SEGMENT_MAGIC, std::memory_order_release);
+            }
+        }
+        close(fd);
+    }
+}
+
+SharedClockPublisher::~SharedClockPublisher() {
+    if (segment) {
+        munmap(segment, sizeof(Segment));
+    }
+}
+
+void SharedClockPublisher::Publish(const SharedClockParams& params) {
+    if (!segment) {
+        return;
+    }
+
+    /*
+     * Single publisher: no other process modifies seq. If a previous
+     * publisher died mid-update seq is already odd: it must not be made
+     * even until the parameters have been re-written.
+     */
+    const uint64_t seq = segment->seq.load(std::memory_order_relaxed) | 1;
+    segment->seq.store(seq, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    segment->baseCounter.store(params.baseCounter, std::memory_order_relaxed);
+    segment->baseNs.store(params.baseNs, std::memory_order_relaxed);
+    segment->mult.store(params.mult, std::memory_order_relaxed);
+    segment->shift.store(params.shift, std::memory_order_relaxed);
+    segment->offsetNs.store(params.offsetNs, std::memory_order_relaxed);
+
+    segment->seq.store(seq + 1, std::memory_order_release);
+}
+
+SharedClockParams SharedClockPublisher::Calibrate(long sampleNs, long offsetNs) {
+    uint64_t startCounter = 0, endCounter = 0;
+    long startNs = 0, endNs = 0;
+
+    Sample(startCounter, startNs);
+    const timespec pause = time_detail::ToTimespec(sampleNs);
+    nanosleep(&pause, nullptr);
+    Sample(endCounter, endNs);
+
+    SharedClockParams params;
+    params.baseCounter = endCounter;
+    params.baseNs = endNs;
+    params.shift = CALIBRATION_SHIFT;
+    params.offsetNs = offsetNs;
+    if (endCounter > startCounter && endNs > startNs) {
+        params.mult = static_cast<uint64_t>(
+            (static_cast<uint128>(endNs - startNs) << CALIBRATION_SHIFT) /
+            (endCounter - startCounter));
+    } else {
+        // Degenerate sample: assume a nano-second counter
+        params.mult = 1ULL << CALIBRATION_SHIFT;
+    }
+    return params;
+}
+
+void SharedClockPublisher::Unlink() {
+    shm_unlink(name.c_str());
+}
+
+/*
+ * Reader
+ * ------
+ */
+SharedClockReader::SharedClockReader(const std::string& name)
+    : segment(nullptr),
+      lastParams(),
+      hasLastParams(false)
+{
+    const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd >= 0) {
+        struct stat info;
+        if (fstat(fd, &info) == 0 &&
+            static_cast<size_t>(info.st_size) >= sizeof(Segment))
+        {
+            void* addr = mmap(nullptr,
+                              sizeof(Segment),
+                              PROT_READ,
+                              MAP_SHARED,
+                              fd,
+                              0);
+            if (addr != MAP_FAILED) {
+                segment = static_cast<const Segment*>(addr);
+            }
+        }
+        close(fd);
+    }
+}
+
+SharedClockReader::~SharedClockReader() {
+    if (segment) {
+        munmap(const_cast<Segment*>(segment), sizeof(Segment));
+    }
+}
+
+bool SharedClockReader::Read(SharedClockParams& params) const {
+    if (ReadParams(segment, params)) {
+        lastParams = params;
+        hasLastParams = true;
+        return true;
+    }
+    return false;
+}
+
+bool SharedClockReader::IsPublished() const {
+    SharedClockParams params;
+    return Read(params);
+}
+
+bool SharedClockReader::Params(SharedClockParams& params) const {
+    return Read(params);
+}
+
+long SharedClockReader::EpochNSecs() const {
+    SharedClockParams params;
+    if (Read(params)) {
+        return ToEpochNSecs(params, ReadClockCounter());
+    } else if (hasLastParams) {
+        // Contended (or abandoned) update: stay on the shared clock
+        return ToEpochNSecs(lastParams, ReadClockCounter());
+    } else {
+        return RealtimeNSecs();
+    }
+}
+
+Time& SharedClockReader::SetNow(Time& time) const {
+    time = time_detail::ToTimespec(EpochNSecs());
+    return time;
+}
@@ -0,0 +1,419 @@
+#include "util_time_trace.h"
+#include "util_time_clock.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+using namespace nstimestamp;
+
+namespace {
+    const uint32_t NO_SPAN = UINT32_MAX;
+
+    struct SpanRecord {
+        long        startNs;
+        long        endNs;
+        const char* name;
+        uint32_t    parent;
+        uint32_t    depth;
+    };
+
+    /**
+     * A single thread's spans.
+     *
+     * Records are stored in fixed size blocks, so that recording never has
+     * to copy (or re-allocate) existing spans. Open spans form a chain
+     * through their parent index, so no separate stack is maintained.
+     */
+    class ThreadBuffer {
+    public:
+        static const size_t BLOCK_SPANS = 4096;
+
+        explicit ThreadBuffer(uint32_t tid)
+            : tid(tid), count(0), current(NO_SPAN), retired(false) { }
+
+        void Begin(const char* name, long now) {
+            Add(name, now, 0);
+            current = static_cast<uint32_t>(count - 1);
+        }
+
+        void Add(const char* name, long start, long end) {
+            if (count == blocks.size() * BLOCK_SPANS) {
+                blocks.emplace_back(new SpanRecord[BLOCK_SPANS]);
+            }
+            SpanRecord& span = Get(count);
+            span.startNs = start;
+            span.endNs = end;
+            span.name = name;
+            span.parent = current;
+            span.depth = (current == NO_SPAN) ? 0 : Get(current).depth + 1;
+            ++count;
+        }
+
+        void End(long now) {
+            if (current != NO_SPAN) {
+                SpanRecord& span = Get(current);
+                span.endNs = now;
+                current = span.parent;
+            }
+        }
+
+        void Clear() {
+            // Keep the first block: it will almost certainly be required again
+            blocks.resize(std::min<size_t>(blocks.size(), 1));
+            current = NO_SPAN;
+            count = 0;
+        }
+
+        SpanRecord& Get(size_t i) {
+            return blocks[i / BLOCK_SPANS][i % BLOCK_SPANS];
+        }
+
+        const SpanRecord& Get(size_t i) const {
+            return blocks[i / BLOCK_SPANS][i % BLOCK_SPANS];
+        }
+
+        size_t Count() const { return count; }
+        uint32_t Tid() const { return tid; }
+
+        // The owning thread has exited: the buffer may be freed by Clear()
+        void Retire() { retired.store(true, std::memory_order_release); }
+        bool Retired() const { return retired.load(std::memory_order_acquire); }
+
+    private:
+        const uint32_t tid;
+        size_t count;
+        uint32_t current;
+        std::atomic<bool> retired;
+        std::vector<std::unique_ptr<SpanRecord[]>> blocks;
+    };
+
+    const size_t ThreadBuffer::BLOCK_SPANS;
+
+    /**
+     * All live thread buffers. Buffers outlive their threads, so that they
+     * can be exported, until the next Clear().
+     */
+    class Registry {
+    public:
+        Registry() : nextTid(1) { }
+
+        ThreadBuffer& Register() {
+            std::unique_lock<std::mutex> lock(mutex);
+            buffers.emplace_back(new ThreadBuffer(nextTid++));
+            return *buffers.back();
+        }
+
+        // Free the buffers of exited threads, and empty the rest
+        void Clear() {
+            std::unique_lock<std::mutex> lock(mutex);
+            buffers.erase(std::remove_if(buffers.begin(), buffers.end(),
+                                         [] (const std::unique_ptr<ThreadBuffer>& buffer) -> bool {
+                                             return buffer->Retired();
+                                         }),
+                          buffers.end());
+            for (const std::unique_ptr<ThreadBuffer>& buffer: buffers) {
+                buffer->Clear();
+            }
+        }
+
+        size_t Size() {
+            std::unique_lock<std::mutex> lock(mutex);
+            return buffers.size();
+        }
+
+        template <class Visit>
+        void ForEachBuffer(Visit visit) {
+            std::unique_lock<std::mutex> lock(mutex);
+            for (const std::unique_ptr<ThreadBuffer>& buffer: buffers) {
+                visit(*buffer);
+            }
+        }
+
+    private:
+        std::mutex mutex;
+        uint32_t nextTid;
+        std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    };
+
+    Registry& GetRegistry() {
+        static Registry registry;
+        return registry;
+    }
+
+    // Constant initialised, avoiding a guard on every access
+    thread_local ThreadBuffer* threadBuffer = nullptr;
+
+    /**
+     * Retires the thread's buffer when the thread exits. Only touched when
+     * the buffer is registered, so the (guarded) initialisation is kept off
+     * the recording path.
+     */
+    struct ThreadExit {
+        ~ThreadExit() {
+            if (threadBuffer) {
+                threadBuffer->Retire();
+                threadBuffer = nullptr;
+            }
+        }
+    };
+
+    thread_local ThreadExit threadExit;
+
+    inline ThreadBuffer& GetThreadBuffer() {
+        if (!threadBuffer) {
+            static_cast<void>(&threadExit);
+            threadBuffer = &GetRegistry().Register();
+        }
+        return *threadBuffer;
+    }
+
+    /**
+     * Buffered output, avoiding a stream operation per field.
+     */
+    class Output {
+    public:
+        explicit Output(std::ostream& os)
+            : os(os), used(0) { }
+
+        ~Output() { Flush(); }
+
+        void Write(const char* data, size_t len) {
+            if (used + len > sizeof(buf)) {
+                Flush();
+                if (len > sizeof(buf)) {
+                    os.write(data, len);
+                    return;
+                }
+            }
+            memcpy(buf + used, data, len);
+            used += len;
+        }
+
+        void Write(const char* str) {
+            Write(str, strlen(str));
+        }
+
+        void Write(const std::string& str) {
+            Write(str.data(), str.size());
+        }
+
+        void WriteUInt(uint64_t value) {
+            char digits[20];
+            size_t len = 0;
+            do {
+                digits[sizeof(digits) - 1 - len] = static_cast<char>('0' + value % 10);
+                value /= 10;
+                ++len;
+            } while (value > 0);
+            Write(digits + sizeof(digits) - len, len);
+        }
+
+        // ns as (fractional) micro-seconds
+        void WriteMicros(long ns) {
+            if (ns < 0) {
+                Write("-", 1);
+                ns = -ns;
+            }
+            WriteUInt(ns / 1000);
+            const unsigned frac = ns % 1000;
+            const char decimals[4] = {
+                '.',
+                static_cast<char>('0' + frac / 100),
+                static_cast<char>('0' + (frac / 10) % 10),
+                static_cast<char>('0' + frac % 10)
+            };
+            Write(decimals, sizeof(decimals));
+        }
+
+        template <class T>
+        void WriteRaw(const T& value) {
+            Write(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+
+        void Flush() {
+            os.write(buf, used);
+            used = 0;
+        }
+
+    private:
+        std::ostream& os;
+        char buf[64 * 1024];
+        size_t used;
+    };
+
+    std::string JSONEscape(const char* name) {
+        std::string escaped;
+        for (const char* c = name; *c; ++c) {
+            switch (*c) {
+                case '"':  escaped += "\\\""; break;
+                case '\\': escaped += "\\\\"; break;
+                case '\n': escaped += "\\n";  break;
+                case '\t': escaped += "\\t";  break;
+                default:
+                    if (static_cast<unsigned char>(*c) < 0x20) {
+                        char code[8];
+                        snprintf(code, sizeof(code), "\\u%04x", *c);
+                        escaped += code;
+                    } else {
+                        escaped += *c;
+                    }
+            }
+        }
+        return escaped;
+    }
+}
+
+void Trace::Begin(const char* name) {
+    GetThreadBuffer().Begin(name, RealtimeNSecs());
+}
+
+void Trace::End() {
+    GetThreadBuffer().End(RealtimeNSecs());
+}
+
+void Trace::Record(const char* name, const Time& start, const Time& end) {
+    GetThreadBuffer().Add(name, start.EpochNSecs(), end.EpochNSecs());
+}
+
+size_t Trace::Spans() {
+    size_t spans = 0;
+    GetRegistry().ForEachBuffer([&spans] (const ThreadBuffer& buffer) -> void {
+        spans += buffer.Count();
+    });
+    return spans;
+}
+
+void Trace::Clear() {
+    GetRegistry().Clear();
+}
+
+size_t Trace::Buffers() {
+    return GetRegistry().Size();
+}
+
+void Trace::WriteChromeJSON(std::ostream& os) {
+    Output out(os);
+    std::string pid = std::to_string(getpid());
+    // Names are escaped once, rather than once per span
+    std::unordered_map<const char*, std::string> names;
+    const char* lastName = nullptr;
+    const std::string* escaped = nullptr;
+    bool first = true;
+
+    /*
+     * Absolute epoch micro-seconds (~1.7e15) are beyond the precision of the
+     * double a viewer parses ts into: write ts relative to the earliest
+     * span instead, recording the base in otherData
+     */
+    long baseNs = LONG_MAX;
+    GetRegistry().ForEachBuffer([&baseNs] (const ThreadBuffer& buffer) -> void {
+        for (size_t i = 0; i < buffer.Count(); ++i) {
+            const SpanRecord& span = buffer.Get(i);
+            if (span.endNs != 0 && span.startNs < baseNs) {
+                baseNs = span.startNs;
+            }
+        }
+    });
+    if (baseNs == LONG_MAX) {
+        baseNs = 0;
+    }
+
+    out.Write("{\"traceEvents\":[");
+    GetRegistry().ForEachBuffer([&] (const ThreadBuffer& buffer) -> void {
+        const std::string tid = std::to_string(buffer.Tid());
+        for (size_t i = 0; i < buffer.Count(); ++i) {
+            const SpanRecord& span = buffer.Get(i);
+            if (span.endNs == 0) {
+                continue;
+            }
+            if (span.name != lastName) {
+                auto it = names.find(span.name);
+                if (it == names.end()) {
+                    it = names.emplace(span.name, JSONEscape(span.name)).first;
+                }
+                lastName = span.name;
+                escaped = &it->second;
+            }
+
+            out.Write(first ? "\n{\"name\":\"" : ",\n{\"name\":\"");
+            first = false;
+            out.Write(*escaped);
+            out.Write("\",\"ph\":\"X\",\"ts\":");
+            out.WriteMicros(span.startNs - baseNs);
+            out.Write(",\"dur\":");
+            out.WriteMicros(span.endNs - span.startNs);
+            out.Write(",\"pid\":");
+            out.Write(pid);
+            out.Write(",\"tid\":");
+            out.Write(tid);
+            out.Write("}");
+        }
+    });
+    out.Write("\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"baseNs\":\"");
+    out.Write(std::to_string(baseNs));
+    out.Write("\"}}\n");
+}
+
+void Trace::WriteBinary(std::ostream& os) {
+    Output out(os);
+
+    // Name table
+    std::unordered_map<const char*, uint32_t> nameIds;
+    std::vector<const char*> names;
+    const char* lastName = nullptr;
+    uint64_t spans = 0;
+    GetRegistry().ForEachBuffer([&] (const ThreadBuffer& buffer) -> void {
+        for (size_t i = 0; i < buffer.Count(); ++i) {
+            const SpanRecord& span = buffer.Get(i);
+            if (span.endNs == 0) {
+                continue;
+            }
+            ++spans;
+            if (span.name != lastName) {
+                lastName = span.name;
+                if (nameIds.emplace(span.name, names.size()).second) {
+                    names.push_back(span.name);
+                }
+            }
+        }
+    });
+
+    out.Write("NSTTRC02", 8);
+    out.WriteRaw(static_cast<uint32_t>(names.size()));
+    for (const char* name: names) {
+        const uint32_t len = strlen(name);
+        out.WriteRaw(len);
+        out.Write(name, len);
+    }
+
+    out.WriteRaw(spans);
+    lastName = nullptr;
+    uint32_t nameId = 0;
+    GetRegistry().ForEachBuffer([&] (const ThreadBuffer& buffer) -> void {
+        for (size_t i = 0; i < buffer.Count(); ++i) {
+            const SpanRecord& span = buffer.Get(i);
+            if (span.endNs == 0) {
+                continue;
+            }
+            if (span.name != lastName) {
+                lastName = span.name;
+                nameId = nameIds[span.name];
+            }
+            out.WriteRaw(static_cast<int64_t>(span.startNs));
+            out.WriteRaw(static_cast<int64_t>(span.endNs - span.startNs));
+            out.WriteRaw(nameId);
+            out.WriteRaw(buffer.Tid());
+            out.WriteRaw(span.depth);
+        }
+    });
+}
@@ -0,0 +1,90 @@
+#include "util_time_unique.h"
+#include "util_time_clock.h"
+#include <algorithm>
+
+using namespace std;
+using namespace nstimestamp;
+
+namespace {
+    std::atomic<uint64_t> nextGeneratorId(1);
+
+    /**
+     * A thread's current reservation from a generator: [next, end)
+     */
+    struct Batch {
+        uint64_t generator;
+        long     next;
+        long     end;
+    };
+
+    /**
+     * Each thread holds a reservation per generator, in a small direct
+     * mapped table: a thread alternating between generators keeps each
+     * batch. Only generators which collide on a slot discard the remainder
+     * of each other's batch.
+     */
+    const size_t BATCH_SLOTS = 8;
+    thread_local Batch batches[BATCH_SLOTS] = {};
+
+}
+
+UniqueTimeGenerator::UniqueTimeGenerator(uint32_t batchSize)
+    : id(nextGeneratorId.fetch_add(1, std::memory_order_relaxed)),
+      batchSize(batchSize > 0 ? batchSize : 1),
+      last(0)
+{
+}
+
+long UniqueTimeGenerator::NextNSecs() {
+    const long now = RealtimeNSecs();
+    if (batchSize == 1) {
+        long end = 0;
+        return Reserve(now, 1, end);
+    }
+
+    // Only hand out a reserved value whilst the clock is still within the
+    // batch: otherwise the IDs would lag behind the time of the event
+    Batch& batch = batches[id % BATCH_SLOTS];
+    if (batch.generator == id && batch.next < batch.end && now < batch.end) {
+        return batch.next++;
+    }
+
+    long end = 0;
+    const long start = Reserve(now, batchSize, end);
+    batch.generator = id;
+    batch.next = start + 1;
+    batch.end = end;
+    return start;
+}
+
+Time& UniqueTimeGenerator::Next(Time& time) {
+    time = time_detail::ToTimespec(NextNSecs());
+    return time;
+}
+
+Time UniqueTimeGenerator::Next() {
+    return Time::FromEpochNSecs(NextNSecs());
+}
+
+/**
+ * Claim up to count values, starting no earlier than now, and after any
+ * value previously claimed. Returns the first value of the range, and sets
+ * end to one past its last.
+ *
+ * Where earlier reservations have already run ahead of the clock, fewer
+ * values are claimed, so that none is more than batchSize ns ahead of now
+ * (at least one value is always claimed).
+ */
+long UniqueTimeGenerator::Reserve(long now, long count, long& end) {
+    long previous = last.load(std::memory_order_relaxed);
+    long start = 0;
+    long claimed = 0;
+    do {
+        start = (now > previous) ? now : previous + 1;
+        claimed = std::max(start, std::min(start + count - 1, now + batchSize));
+    } while (!last.compare_exchange_weak(previous,
+                                         claimed,
+                                         std::memory_order_relaxed));
+    end = claimed + 1;
+    return start;
+}
@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+#include <util_time_format.h>
+
+using namespace std;
+using namespace nstimestamp;
+
+namespace {
+    const string reftime = "20140403 10:11:02.294930123";
+
+    constexpr char LogSpec[] = "%H:%M:%S.%6N";
+    constexpr char CSVSpec[] = "%Y-%m-%d %H:%M:%S.%3N";
+    constexpr char FIXSpec[] = "%Y%m%d-%H:%M:%S.%3N";
+    constexpr char NanoSpec[] = "%Y%m%d %H:%M:%S.%9N";
+    constexpr char PercentSpec[] = "%%%H%%";
+
+    typedef StaticFormat<LogSpec> LogFormat;
+    typedef StaticFormat<CSVSpec> CSVFormat;
+    typedef StaticFormat<FIXSpec> FIXFormat;
+    typedef StaticFormat<NanoSpec> NanoFormat;
+    typedef StaticFormat<PercentSpec> PercentFormat;
+}
+
+TEST(StaticFormat, Length) {
+    static_assert(LogFormat::Length == 15, "HH:MM:SS.uuuuuu");
+    static_assert(CSVFormat::Length == 23, "YYYY-MM-DD HH:MM:SS.mmm");
+    static_assert(FIXFormat::Length == 21, "YYYYMMDD-HH:MM:SS.sss");
+    static_assert(NanoFormat::Length == 27, "YYYYMMDD HH:MM:SS.nnnnnnnnn");
+    static_assert(PercentFormat::Length == 4, "%HH%");
+}
+
+TEST(StaticFormat, Write) {
+    const Time time(reftime);
+    ASSERT_EQ(LogFormat::Format(time), "10:11:02.294930");
+    ASSERT_EQ(CSVFormat::Format(time), "2014-04-03 10:11:02.294");
+    ASSERT_EQ(FIXFormat::Format(time), "20140403-10:11:02.294");
+    ASSERT_EQ(PercentFormat::Format(time), "%10%");
+}
+
+TEST(StaticFormat, WriteMatchesTimestamp) {
+    const Time time(reftime);
+    ASSERT_EQ(NanoFormat::Format(time), time.Timestamp());
+}
+
+TEST(StaticFormat, WriteNoTerminator) {
+    char buf[LogFormat::Length + 1];
+    buf[LogFormat::Length] = 'X';
+    LogFormat::Write(Time(reftime), buf);
+    ASSERT_EQ(buf[LogFormat::Length], 'X');
+}
+
+TEST(StaticFormat, RoundTrip) {
+    const Time time(reftime);
+    Time parsed(Time::EpochTimestamp);
+    ASSERT_TRUE(NanoFormat::Parse(NanoFormat::Format(time), parsed));
+    ASSERT_EQ(parsed.EpochNSecs(), time.EpochNSecs());
+    ASSERT_EQ(parsed.Timestamp(), reftime);
+}
+
+TEST(StaticFormat, ParseCSV) {
+    Time parsed;
+    ASSERT_TRUE(CSVFormat::Parse("2014-04-03 10:11:02.294", parsed));
+    ASSERT_EQ(parsed.Timestamp(), "20140403 10:11:02.294000000");
+}
+
+TEST(StaticFormat, ParseFIX) {
+    Time parsed;
+    ASSERT_TRUE(FIXFormat::Parse("20140403-10:11:02.294", parsed));
+    ASSERT_EQ(parsed.Timestamp(), "20140403 10:11:02.294000000");
+}
+
+TEST(StaticFormat, ParseTimeOnly) {
+    Time parsed;
+    ASSERT_TRUE(LogFormat::Parse("10:11:02.294930", parsed));
+    ASSERT_EQ(parsed.Timestamp(), "19700101 10:11:02.294930000");
+}
+
+TEST(StaticFormat, ParseTrailingData) {
+    Time parsed;
+    ASSERT_TRUE(LogFormat::Parse("10:11:02.294930 - Message", parsed));
+    ASSERT_EQ(parsed.Timestamp(), "19700101 10:11:02.294930000");
+}
+
+TEST(StaticFormat, ParseTooShort) {
+    Time parsed(reftime);
+    ASSERT_FALSE(LogFormat::Parse("10:11:02.2949", parsed));
+    ASSERT_EQ(parsed.Timestamp(), reftime);
+}
+
+TEST(StaticFormat, ParseBadLiteral) {
+    Time parsed(reftime);
+    ASSERT_FALSE(FIXFormat::Parse("20140403 10:11:02.294", parsed));
+    ASSERT_EQ(parsed.Timestamp(), reftime);
+}
+
+TEST(StaticFormat, ParseBadDigit) {
+    Time parsed(reftime);
+    ASSERT_FALSE(FIXFormat::Parse("2014O403-10:11:02.294", parsed));
+    ASSERT_EQ(parsed.Timestamp(), reftime);
+}
+
+TEST(StaticFormat, ParsePreEpoch) {
+    Time parsed;
+    ASSERT_TRUE(CSVFormat::Parse("1969-12-31 23:59:59.000", parsed));
+    ASSERT_EQ(parsed.EpochSecs(), -1);
+}
+
+TEST(StaticFormat, ParseOutOfRange) {
+    Time parsed(reftime);
+    for (const char* stamp: {"2014-13-45 99:99:99.000",
+                             "2014-00-03 10:11:02.294",
+                             "2014-13-03 10:11:02.294",
+                             "2014-04-00 10:11:02.294",
+                             "2014-04-32 10:11:02.294",
+                             "2014-04-03 24:11:02.294",
+                             "2014-04-03 10:60:02.294",
+                             "2014-04-03 10:11:61.294"})
+    {
+        ASSERT_FALSE(CSVFormat::Parse(stamp, parsed)) << stamp;
+        ASSERT_EQ(parsed.Timestamp(), reftime);
+    }
+}
+
+TEST(StaticFormat, ParseRangeLimits) {
+    Time parsed;
+    ASSERT_TRUE(CSVFormat::Parse("2014-12-31 23:59:59.999", parsed));
+    ASSERT_EQ(parsed.Timestamp(), "20141231 23:59:59.999000000");
+    ASSERT_TRUE(CSVFormat::Parse("2014-01-01 00:00:00.000", parsed));
+    ASSERT_EQ(parsed.Timestamp(), "20140101 00:00:00.000000000");
+}
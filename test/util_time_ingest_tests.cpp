@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include <util_time_ingest.h>
+#include <fstream>
+#include <unistd.h>
+
+using namespace std;
+using namespace nstimestamp;
+
+namespace {
+    const long SEC = 1000000000L;
+    const long base = 1396519862L * SEC;
+
+    /**
+     * lines timestamps, alternating between the two formats, 1.001s apart
+     */
+    std::string Column(size_t lines, std::vector<long>& expected) {
+        std::string column;
+        for (size_t i = 0; i < lines; ++i) {
+            const long ns = base + i * (SEC + 1000000);
+            const Time stamp = Time::FromEpochNSecs(ns);
+            column += (i % 2) ? stamp.Timestamp() : stamp.ISO8601Timestamp();
+            column += ",payload\n";
+            expected.push_back(ns);
+        }
+        return column;
+    }
+}
+
+TEST(TimestampIngest, Defaults) {
+    TimestampIngest ingest;
+    ASSERT_GE(ingest.Threads(), 1);
+    ASSERT_EQ(ingest.ChunkBytes(), TimestampIngest::DEFAULT_CHUNK_BYTES);
+}
+
+TEST(TimestampIngest, Empty) {
+    std::vector<long> epochNs = {1, 2, 3};
+    TimestampIngest(4).Ingest("", 0, epochNs);
+    ASSERT_EQ(epochNs.size(), 0);
+}
+
+TEST(TimestampIngest, SingleChunk) {
+    std::vector<long> expected, epochNs;
+    const std::string column = Column(100, expected);
+    TimestampIngest(1).Ingest(column.c_str(), column.size(), epochNs);
+    ASSERT_EQ(epochNs, expected);
+}
+
+TEST(TimestampIngest, ManyChunks) {
+    std::vector<long> expected;
+    const std::string column = Column(10000, expected);
+    for (size_t threads = 1; threads <= 8; ++threads) {
+        // Smaller than a line: every line is its own chunk
+        for (size_t chunk: {1, 100, 4096}) {
+            std::vector<long> epochNs;
+            TimestampIngest(threads, chunk).Ingest(column.c_str(), column.size(), epochNs);
+            ASSERT_EQ(epochNs, expected) << threads << " threads, " << chunk << " byte chunks";
+        }
+    }
+}
+
+TEST(TimestampIngest, UnterminatedLine) {
+    std::vector<long> expected, epochNs;
+    std::string column = Column(10, expected);
+    column.pop_back();
+    TimestampIngest(2, 64).Ingest(column.c_str(), column.size(), epochNs);
+    ASSERT_EQ(epochNs, expected);
+}
+
+TEST(TimestampIngest, ShortLines) {
+    const std::string column = "20140403 10:11:02.294930000\n\nshort\n";
+    std::vector<long> epochNs;
+    TimestampIngest(2, 1).Ingest(column.c_str(), column.size(), epochNs);
+    ASSERT_EQ(epochNs.size(), 3);
+    ASSERT_EQ(epochNs[0], Time("20140403 10:11:02.294930000").EpochNSecs());
+    ASSERT_EQ(epochNs[1], 0);
+    ASSERT_EQ(epochNs[2], 0);
+}
+
+TEST(TimestampIngest, File) {
+    const std::string path = "/tmp/nstimestamp_ingest_" + std::to_string(getpid());
+    std::vector<long> expected, epochNs;
+    {
+        std::ofstream file(path);
+        file << Column(5000, expected);
+    }
+    ASSERT_TRUE(TimestampIngest(4, 1000).Ingest(path, epochNs));
+    unlink(path.c_str());
+    ASSERT_EQ(epochNs, expected);
+}
+
+TEST(TimestampIngest, MissingFile) {
+    std::vector<long> epochNs = {1, 2, 3};
+    ASSERT_FALSE(TimestampIngest().Ingest("/tmp/nstimestamp_no_such_file", epochNs));
+    ASSERT_EQ(epochNs.size(), 0);
+}
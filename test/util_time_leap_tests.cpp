@@ -0,0 +1,257 @@
+#include <gtest/gtest.h>
+#include <util_time_leap.h>
+#include <util_time_format.h>
+#include <fstream>
+#include <unistd.h>
+
+using namespace std;
+using namespace nstimestamp;
+
+namespace {
+    const long SEC = 1000000000L;
+    // 2017-01-01 00:00:00, immediately after the 2016 leap second
+    const long newYear2017 = 1483228800L;
+
+    constexpr char NanoSpec[] = "%Y%m%d %H:%M:%S.%9N";
+
+    std::string WriteList(const std::string& contents) {
+        const std::string path = "/tmp/nstimestamp_leap_" + std::to_string(getpid());
+        std::ofstream file(path);
+        file << contents;
+        return path;
+    }
+}
+
+TEST(LeapSecondTime, ParseTimestamp) {
+    const Time leap("20161231 23:59:60.500000000");
+    ASSERT_TRUE(leap.IsLeapSecond());
+    ASSERT_EQ(leap.Year(), 2016);
+    ASSERT_EQ(leap.Month(), 12);
+    ASSERT_EQ(leap.MDay(), 31);
+    ASSERT_EQ(leap.Hour(), 23);
+    ASSERT_EQ(leap.Minute(), 59);
+    ASSERT_EQ(leap.Second(), 60);
+    ASSERT_EQ(leap.MSec(), 500);
+    ASSERT_EQ(leap.USec(), 500000);
+    ASSERT_EQ(leap.NSec(), 500000000);
+    ASSERT_EQ(leap.Timestamp(), "20161231 23:59:60.500000000");
+    ASSERT_EQ(leap.ISO8601Timestamp(), "2016-12-31T23:59:60.500000Z");
+}
+
+TEST(LeapSecondTime, ParseISOTimestamp) {
+    const Time leap("2016-12-31T23:59:60.250000Z");
+    ASSERT_TRUE(leap.IsLeapSecond());
+    ASSERT_EQ(leap.Second(), 60);
+    ASSERT_EQ(leap.ISO8601Timestamp(), "2016-12-31T23:59:60.250000Z");
+    ASSERT_EQ(leap.Timestamp(), "20161231 23:59:60.250000000");
+}
+
+TEST(LeapSecondTime, StaticFormat) {
+    typedef StaticFormat<NanoSpec> Format;
+    Time leap(timespec{0, 0});
+    ASSERT_TRUE(Format::Parse("20161231 23:59:60.500000000", leap));
+    ASSERT_TRUE(leap.IsLeapSecond());
+    ASSERT_EQ(Format::Format(leap), "20161231 23:59:60.500000000");
+    ASSERT_EQ(leap.Timestamp(), "20161231 23:59:60.500000000");
+}
+
+/**
+ * Leap seconds only occur at 23:59:60: any other :60 rolls into the next
+ * minute
+ */
+TEST(LeapSecondTime, NotEndOfDay) {
+    for (const char* stamp: {"20140403 10:11:60.000000000",
+                             "2014-04-03T10:11:60.000000Z",
+                             "20161231 23:58:60.000000000",
+                             "20161231 22:59:60.000000000"})
+    {
+        const Time time(stamp);
+        ASSERT_FALSE(time.IsLeapSecond()) << stamp;
+        ASSERT_EQ(time.Second(), 0) << stamp;
+    }
+    const Time time("20140403 10:11:60.500000000");
+    ASSERT_EQ(time.Timestamp(), "20140403 10:12:00.500000000");
+    ASSERT_EQ(time.EpochNSecs(), Time("20140403 10:12:00.500000000").EpochNSecs());
+
+    typedef StaticFormat<NanoSpec> Format;
+    Time parsed(timespec{0, 0});
+    ASSERT_TRUE(Format::Parse("20140403 10:11:60.500000000", parsed));
+    ASSERT_FALSE(parsed.IsLeapSecond());
+    ASSERT_EQ(parsed.Timestamp(), "20140403 10:12:00.500000000");
+    ASSERT_EQ(parsed.EpochNSecs(), time.EpochNSecs());
+}
+
+TEST(LeapSecondTime, PosixValues) {
+    // POSIX time repeats the following second
+    const Time leap("20161231 23:59:60.500000000");
+    const Time next("20170101 00:00:00.500000000");
+    ASSERT_FALSE(next.IsLeapSecond());
+    ASSERT_EQ(leap.EpochNSecs(), next.EpochNSecs());
+    ASSERT_EQ(leap.EpochUSecs(), next.EpochUSecs());
+    ASSERT_EQ(leap.EpochSecs(), next.EpochSecs());
+    ASSERT_EQ(leap.EpochSecs(), newYear2017);
+
+    const Time before("20161231 23:59:59.750000000");
+    ASSERT_EQ(leap.DiffSecs(before), 0);
+    ASSERT_EQ(leap.DiffNSecs(before), 750000000);
+    ASSERT_EQ(before.DiffSecs(leap), -1);
+}
+
+TEST(LeapSeconds, TaiOffset) {
+    const LeapSeconds leaps;
+    ASSERT_EQ(leaps.Size(), 28);
+    ASSERT_EQ(leaps.TaiOffset("19700101 00:00:00.000000000"), 10);
+    ASSERT_EQ(leaps.TaiOffset("19720101 00:00:00.000000000"), 10);
+    ASSERT_EQ(leaps.TaiOffset("19720701 00:00:00.000000000"), 11);
+    ASSERT_EQ(leaps.TaiOffset("20161231 23:59:59.999999999"), 36);
+    ASSERT_EQ(leaps.TaiOffset("20161231 23:59:60.500000000"), 36);
+    ASSERT_EQ(leaps.TaiOffset("20170101 00:00:00.000000000"), 37);
+    ASSERT_EQ(leaps.TaiOffset("20300101 00:00:00.000000000"), 37);
+}
+
+TEST(LeapSeconds, UtcToTai) {
+    const LeapSeconds leaps;
+    const Time before("20161231 23:59:59.500000000");
+    const Time leap("20161231 23:59:60.500000000");
+    const Time after("20170101 00:00:00.500000000");
+
+    const long base = (newYear2017 + 36) * SEC;
+    ASSERT_EQ(leaps.UtcToTai(before), base - SEC / 2);
+    ASSERT_EQ(leaps.UtcToTai(leap), base + SEC / 2);
+    ASSERT_EQ(leaps.UtcToTai(after), base + SEC + SEC / 2);
+}
+
+TEST(LeapSeconds, TaiToUtc) {
+    const LeapSeconds leaps;
+    for (const char* stamp: {"19650101 12:00:00.000000001",
+                             "19720630 23:59:59.999999999",
+                             "19720630 23:59:60.000000000",
+                             "19720701 00:00:00.000000000",
+                             "20161231 23:59:59.500000000",
+                             "20161231 23:59:60.000000000",
+                             "20161231 23:59:60.999999999",
+                             "20170101 00:00:00.000000000",
+                             "20300101 00:00:00.123456789"})
+    {
+        const Time utc = leaps.TaiToUtc(leaps.UtcToTai(stamp));
+        ASSERT_EQ(utc.Timestamp(), stamp);
+        ASSERT_EQ(utc.IsLeapSecond(), Time(stamp).IsLeapSecond());
+    }
+}
+
+TEST(LeapSeconds, Diffs) {
+    const LeapSeconds leaps;
+    const Time start("20140403 10:11:02.194930");
+    const Time end("20170403 10:11:02.194930");
+
+    // Leap seconds were inserted on 30th June 2015, and 31st December 2016
+    const long threeYears = ((3 * 365 + 1) * 24 * 60 * 60);
+    ASSERT_EQ(end.DiffSecs(start), threeYears);
+    ASSERT_EQ(leaps.DiffSecs(end, start), threeYears + 2);
+    ASSERT_EQ(leaps.DiffSecs(start, end), -(threeYears + 2));
+    ASSERT_EQ(leaps.DiffUSecs(end, start), (threeYears + 2) * 1000000L);
+    ASSERT_EQ(leaps.DiffNSecs(end, start), (threeYears + 2) * SEC);
+
+    // Across midnight on New Year's eve 2016
+    const Time before("20161231 23:59:59.000000000");
+    const Time leap("20161231 23:59:60.000000000");
+    const Time after("20170101 00:00:00.000000000");
+    ASSERT_EQ(after.DiffSecs(before), 1);
+    ASSERT_EQ(leaps.DiffSecs(after, before), 2);
+    ASSERT_EQ(leaps.DiffSecs(leap, before), 1);
+    ASSERT_EQ(leaps.DiffSecs(after, leap), 1);
+}
+
+TEST(LeapSeconds, Cursor) {
+    const LeapSeconds leaps;
+    LeapSeconds::Cursor cursor(leaps);
+
+    // Two hours either side of the leap second, in 10ms steps
+    const long from = (newYear2017 - 7200) * SEC;
+    const long to = (newYear2017 + 7200) * SEC;
+    long lastTai = 0;
+    for (long utc = from; utc < to; utc += 10000000L) {
+        const long tai = cursor.UtcToTai(utc);
+        ASSERT_EQ(tai, leaps.UtcToTai(Time::FromEpochNSecs(utc)));
+        if (utc > from) {
+            // POSIX time skips the leap second
+            ASSERT_EQ(tai - lastTai, utc == newYear2017 * SEC ? SEC + 10000000L : 10000000L);
+        }
+        ASSERT_EQ(cursor.TaiToUtc(tai).EpochNSecs(), utc);
+        lastTai = tai;
+    }
+
+    // And backwards
+    ASSERT_EQ(cursor.UtcToTai(0), 10 * SEC);
+    ASSERT_EQ(cursor.TaiToUtc(10 * SEC).EpochNSecs(), 0);
+}
+
+TEST(LeapSeconds, Batch) {
+    const LeapSeconds leaps;
+    std::vector<Time> times;
+    std::vector<long> epochNs;
+    for (long utc = (newYear2017 - 100) * SEC; utc < (newYear2017 + 100) * SEC; utc += SEC / 3) {
+        times.push_back(Time::FromEpochNSecs(utc));
+        epochNs.push_back(utc);
+    }
+    times.push_back("20161231 23:59:60.500000000");
+    epochNs.push_back(times.back().EpochNSecs());
+
+    std::vector<long> fromTimes(times.size()), fromNs(times.size());
+    leaps.UtcToTai(times.data(), fromTimes.data(), times.size());
+    leaps.UtcToTai(epochNs.data(), fromNs.data(), epochNs.size());
+    for (size_t i = 0; i < times.size() - 1; ++i) {
+        ASSERT_EQ(fromTimes[i], leaps.UtcToTai(times[i]));
+        ASSERT_EQ(fromNs[i], fromTimes[i]);
+    }
+    // The leap second can not be represented as an epoch-ns value
+    ASSERT_EQ(fromTimes.back(), fromNs.back() - SEC);
+}
+
+TEST(LeapSeconds, LoadSystemList) {
+    LeapSeconds leaps;
+    if (!leaps.Load()) {
+        // No tzdata installed: nothing to compare
+        return;
+    }
+    ASSERT_GE(leaps.Size(), 28);
+    ASSERT_EQ(leaps.TaiOffset("20170101 00:00:00.000000000"), 37);
+    ASSERT_EQ(leaps.DiffSecs("20170101 00:00:00.000000000", "20161231 23:59:59.000000000"), 2);
+}
+
+TEST(LeapSeconds, LoadList) {
+    const std::string path = WriteList(
+        "# A short table\n"
+        "#@	3991593600\n"
+        "2272060800	10	# 1 Jan 1972\n"
+        "\n"
+        "3692217600	11	# 1 Jan 2017\n");
+    LeapSeconds leaps;
+    ASSERT_TRUE(leaps.Load(path));
+    unlink(path.c_str());
+
+    ASSERT_EQ(leaps.Size(), 2);
+    ASSERT_EQ(leaps.TaiOffset("20161231 23:59:59.000000000"), 10);
+    ASSERT_EQ(leaps.TaiOffset("20170101 00:00:00.000000000"), 11);
+    ASSERT_EQ(leaps.DiffSecs("20170101 00:00:00.000000000", "19800101 00:00:00.000000000"),
+              Time("20170101 00:00:00.000000000").DiffSecs("19800101 00:00:00.000000000") + 1);
+}
+
+TEST(LeapSeconds, LoadInvalid) {
+    LeapSeconds leaps;
+    ASSERT_FALSE(leaps.Load("/tmp/nstimestamp_no_such_file"));
+
+    for (const char* contents: {"# Empty\n",
+                                "2272060800\n",
+                                "garbage 10\n",
+                                "2272060800 10\n2272060800 11\n",
+                                "2272060800 10\n3692217600 12\n"})
+    {
+        const std::string path = WriteList(contents);
+        ASSERT_FALSE(leaps.Load(path)) << contents;
+        unlink(path.c_str());
+    }
+
+    // Untouched
+    ASSERT_EQ(leaps.Size(), 28);
+}
@@ -0,0 +1,236 @@
+#include <gtest/gtest.h>
+#include <util_time_log_index.h>
+#include <cstdio>
+#include <fstream>
+#include <unistd.h>
+
+using namespace std;
+using namespace nstimestamp;
+
+namespace {
+    const long SEC = 1000000000L;
+    const long base = 1396519862L * SEC;
+
+    std::string LogPath(const std::string& test) {
+        return "/tmp/nstimestamp_" + test + "_" + std::to_string(getpid()) + ".log";
+    }
+
+    std::string Line(long i) {
+        return Time::FromEpochNSecs(base + i * SEC).Timestamp() + " Message " + std::to_string(i);
+    }
+
+    /**
+     * Append lines [first, last), one per second from base
+     */
+    void WriteLog(const std::string& path, long first, long last, bool append = true) {
+        std::ofstream log(path, append ? std::ios::app : std::ios::trunc);
+        for (long i = first; i < last; ++i) {
+            log << Line(i) << "\n";
+        }
+    }
+
+    std::vector<std::string> Query(const LogTimeIndex& index, long from, long to) {
+        std::vector<std::string> lines;
+        index.ForEachLine(Time::FromEpochNSecs(base + from * SEC),
+                          Time::FromEpochNSecs(base + to * SEC),
+                          [&lines] (const char* line, size_t len) -> void {
+            lines.emplace_back(line, len);
+        });
+        return lines;
+    }
+
+    void AssertLines(const std::vector<std::string>& lines, long first, long last) {
+        ASSERT_EQ(lines.size(), last - first);
+        for (long i = first; i < last; ++i) {
+            ASSERT_EQ(lines[i - first], Line(i));
+        }
+    }
+
+    class LogIndexTest: public ::testing::Test {
+    protected:
+        void TearDown() override {
+            unlink(path.c_str());
+            unlink(LogTimeIndex::SidecarPath(path).c_str());
+        }
+
+        std::string path = LogPath(
+            ::testing::UnitTest::GetInstance()->current_test_info()->name());
+    };
+}
+
+TEST_F(LogIndexTest, Build) {
+    WriteLog(path, 0, 1000);
+    LogTimeIndex index(path, 10);
+    ASSERT_TRUE(index.Update());
+    ASSERT_EQ(index.IndexedLines(), 1000);
+    ASSERT_EQ(index.Entries().size(), 100);
+    ASSERT_EQ(index.Entries()[1].epochNs, base + 10 * SEC);
+}
+
+TEST_F(LogIndexTest, Range) {
+    WriteLog(path, 0, 1000);
+    LogTimeIndex index(path, 10);
+    ASSERT_TRUE(index.Update());
+    AssertLines(Query(index, 105, 217), 105, 217);
+    AssertLines(Query(index, 0, 3), 0, 3);
+    AssertLines(Query(index, 990, 2000), 990, 1000);
+    ASSERT_EQ(Query(index, 2000, 3000).size(), 0);
+    ASSERT_EQ(Query(index, -10, 0).size(), 0);
+}
+
+TEST_F(LogIndexTest, SubSecondBounds) {
+    WriteLog(path, 0, 100);
+    LogTimeIndex index(path, 10);
+    ASSERT_TRUE(index.Update());
+    const LogTimeIndex::Range range = index.Find(Time::FromEpochNSecs(base + 10 * SEC + 1),
+                                                 Time::FromEpochNSecs(base + 20 * SEC + 1));
+    // Lines 11 -> 20 inclusive
+    ASSERT_EQ(range.end - range.begin, 10 * (Line(11) + "\n").size());
+}
+
+TEST_F(LogIndexTest, Persisted) {
+    WriteLog(path, 0, 1000);
+    {
+        LogTimeIndex index(path, 10);
+        ASSERT_TRUE(index.Update());
+    }
+    // The stride is loaded from the sidecar
+    LogTimeIndex loaded(path);
+    ASSERT_EQ(loaded.Stride(), 10);
+    ASSERT_EQ(loaded.IndexedLines(), 1000);
+    ASSERT_EQ(loaded.Entries().size(), 100);
+    AssertLines(Query(loaded, 500, 600), 500, 600);
+}
+
+TEST_F(LogIndexTest, Incremental) {
+    WriteLog(path, 0, 500);
+    LogTimeIndex index(path, 10);
+    ASSERT_TRUE(index.Update());
+
+    WriteLog(path, 500, 1000);
+    // New lines are found, even before they are indexed
+    AssertLines(Query(index, 450, 550), 450, 550);
+
+    LogTimeIndex reloaded(path);
+    ASSERT_TRUE(reloaded.Update());
+    ASSERT_EQ(reloaded.IndexedLines(), 1000);
+    ASSERT_EQ(reloaded.Entries().size(), 100);
+    AssertLines(Query(reloaded, 450, 550), 450, 550);
+    AssertLines(Query(LogTimeIndex(path), 950, 1000), 950, 1000);
+}
+
+TEST_F(LogIndexTest, IncompleteLine) {
+    WriteLog(path, 0, 10);
+    {
+        std::ofstream log(path, std::ios::app);
+        log << Line(10).substr(0, 10);
+    }
+    LogTimeIndex index(path, 1);
+    ASSERT_TRUE(index.Update());
+    ASSERT_EQ(index.IndexedLines(), 10);
+
+    {
+        std::ofstream log(path, std::ios::app);
+        log << Line(10).substr(10) << "\n";
+    }
+    ASSERT_TRUE(index.Update());
+    ASSERT_EQ(index.IndexedLines(), 11);
+    ASSERT_EQ(index.Entries().back().epochNs, base + 10 * SEC);
+}
+
+TEST_F(LogIndexTest, Truncated) {
+    WriteLog(path, 0, 1000);
+    LogTimeIndex index(path, 10);
+    ASSERT_TRUE(index.Update());
+
+    WriteLog(path, 2000, 2100, false);
+    LogTimeIndex reloaded(path);
+    ASSERT_TRUE(reloaded.Update());
+    ASSERT_EQ(reloaded.IndexedLines(), 100);
+    ASSERT_EQ(reloaded.Entries().size(), 10);
+    AssertLines(Query(reloaded, 2050, 2060), 2050, 2060);
+}
+
+/**
+ * copytruncate: the log is truncated in place (same inode), and re-grows past
+ * the previously indexed size before the next Update()
+ */
+TEST_F(LogIndexTest, TruncatedAndRegrown) {
+    WriteLog(path, 0, 1000);
+    LogTimeIndex index(path, 10);
+    ASSERT_TRUE(index.Update());
+    const uint64_t indexedBytes = index.IndexedBytes();
+
+    WriteLog(path, 5000, 6200, false);
+    {
+        std::ifstream log(path, std::ios::ate);
+        ASSERT_GT(static_cast<uint64_t>(log.tellg()), indexedBytes);
+    }
+
+    // Queries ignore the stale index...
+    AssertLines(Query(index, 5100, 5110), 5100, 5110);
+    AssertLines(Query(LogTimeIndex(path), 6150, 6200), 6150, 6200);
+
+    // ...until it is rebuilt
+    ASSERT_TRUE(index.Update());
+    ASSERT_EQ(index.IndexedLines(), 1200);
+    ASSERT_EQ(index.Entries().size(), 120);
+    ASSERT_EQ(index.Entries()[0].epochNs, base + 5000 * SEC);
+    AssertLines(Query(index, 5100, 5110), 5100, 5110);
+
+    LogTimeIndex reloaded(path);
+    ASSERT_TRUE(reloaded.Update());
+    ASSERT_EQ(reloaded.IndexedLines(), 1200);
+    AssertLines(Query(reloaded, 6000, 6010), 6000, 6010);
+}
+
+/**
+ * Only the end of the indexed section differs (e.g. a re-created log which
+ * happens to start with the same line)
+ */
+TEST_F(LogIndexTest, ReplacedTail) {
+    WriteLog(path, 0, 100);
+    LogTimeIndex index(path, 10);
+    ASSERT_TRUE(index.Update());
+
+    WriteLog(path, 0, 1, false);
+    WriteLog(path, 3000, 3200);
+    ASSERT_TRUE(index.Update());
+    ASSERT_EQ(index.IndexedLines(), 201);
+    AssertLines(Query(index, 3050, 3060), 3050, 3060);
+}
+
+TEST_F(LogIndexTest, ContinuationLines) {
+    {
+        std::ofstream log(path);
+        for (long i = 0; i < 100; ++i) {
+            log << Line(i) << "\n";
+            log << "    continuation of " << i << "\n";
+        }
+    }
+    LogTimeIndex index(path, 3);
+    ASSERT_TRUE(index.Update());
+    std::vector<std::string> lines = Query(index, 10, 12);
+    ASSERT_EQ(lines.size(), 4);
+    ASSERT_EQ(lines[0], Line(10));
+    ASSERT_EQ(lines[1], "    continuation of 10");
+    ASSERT_EQ(lines[2], Line(11));
+    ASSERT_EQ(lines[3], "    continuation of 11");
+}
+
+TEST_F(LogIndexTest, ISOTimestamps) {
+    {
+        std::ofstream log(path);
+        for (long i = 0; i < 100; ++i) {
+            log << Time::FromEpochNSecs(base + i * SEC).ISO8601Timestamp() << " Message\n";
+        }
+    }
+    LogTimeIndex index(path, 10);
+    ASSERT_TRUE(index.Update());
+    ASSERT_EQ(Query(index, 25, 75).size(), 50);
+}
+
+TEST_F(LogIndexTest, MissingLog) {
+    LogTimeIndex index(path);
+    ASSERT_FALSE(index.Update());
+}
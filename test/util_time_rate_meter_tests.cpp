@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include <util_time_rate_meter.h>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace nstimestamp;
+
+namespace {
+    const long MS = 1000000L;
+
+    // 10 x 1ms buckets, 4 shards
+    const long width = MS;
+    const size_t buckets = 10;
+
+    const long base = 1396519862L * 1000000000L;
+}
+
+TEST(RateMeter, Empty) {
+    RateMeter meter(width, buckets, 4);
+    ASSERT_EQ(meter.Count(Time::FromEpochNSecs(base), buckets), 0);
+    ASSERT_EQ(meter.Rate(Time::FromEpochNSecs(base), buckets), 0);
+    ASSERT_EQ(meter.PeakRate(Time::FromEpochNSecs(base), buckets), 0);
+    ASSERT_EQ(meter.EWMARate(Time::FromEpochNSecs(base), 5 * MS), 0);
+}
+
+TEST(RateMeter, CurrentBucketExcluded) {
+    RateMeter meter(width, buckets, 4);
+    meter.Record(Time::FromEpochNSecs(base));
+    ASSERT_EQ(meter.Count(Time::FromEpochNSecs(base), buckets), 0);
+    ASSERT_EQ(meter.Count(Time::FromEpochNSecs(base + width), buckets), 1);
+}
+
+TEST(RateMeter, Count) {
+    RateMeter meter(width, buckets, 4);
+    for (long i = 0; i < 10; ++i) {
+        meter.Record(Time::FromEpochNSecs(base + i * width), i + 1);
+    }
+    const Time now = Time::FromEpochNSecs(base + 10 * width);
+    ASSERT_EQ(meter.Count(now, 1), 10);
+    ASSERT_EQ(meter.Count(now, 2), 10 + 9);
+    ASSERT_EQ(meter.Count(now, 10), 55);
+    // Clamped to the size of the ring
+    ASSERT_EQ(meter.Count(now, 100), 55);
+}
+
+TEST(RateMeter, Rate) {
+    RateMeter meter(width, buckets, 4);
+    for (long i = 0; i < 10; ++i) {
+        meter.Record(Time::FromEpochNSecs(base + i * width), 5);
+    }
+    const Time now = Time::FromEpochNSecs(base + 10 * width);
+    // 5 events per ms
+    ASSERT_DOUBLE_EQ(meter.Rate(now, 10), 5000.0);
+    ASSERT_DOUBLE_EQ(meter.Rate(now, 3), 5000.0);
+}
+
+TEST(RateMeter, PeakRate) {
+    RateMeter meter(width, buckets, 4);
+    meter.Record(Time::FromEpochNSecs(base + 2 * width), 3);
+    meter.Record(Time::FromEpochNSecs(base + 5 * width), 7);
+    meter.Record(Time::FromEpochNSecs(base + 8 * width), 2);
+    const Time now = Time::FromEpochNSecs(base + 10 * width);
+    ASSERT_DOUBLE_EQ(meter.PeakRate(now, 10), 7000.0);
+    ASSERT_DOUBLE_EQ(meter.PeakRate(now, 2), 2000.0);
+}
+
+TEST(RateMeter, EWMA) {
+    RateMeter meter(width, buckets, 4);
+    for (long i = 0; i < 10; ++i) {
+        meter.Record(Time::FromEpochNSecs(base + i * width), 4);
+    }
+    const Time now = Time::FromEpochNSecs(base + 10 * width);
+    ASSERT_DOUBLE_EQ(meter.EWMARate(now, 3 * MS), 4000.0);
+
+    // Activity stops: the average decays towards zero
+    const double decayed = meter.EWMARate(Time::FromEpochNSecs(base + 15 * width), 3 * MS);
+    ASSERT_GT(decayed, 0);
+    ASSERT_LT(decayed, 4000.0);
+}
+
+TEST(RateMeter, RingWraps) {
+    RateMeter meter(width, buckets, 4);
+    meter.Record(Time::FromEpochNSecs(base), 100);
+    meter.Record(Time::FromEpochNSecs(base + 11 * width), 1);
+    // The first bucket has been overwritten, and has aged out of the window
+    ASSERT_EQ(meter.Count(Time::FromEpochNSecs(base + 12 * width), buckets), 1);
+    ASSERT_EQ(meter.Count(Time::FromEpochNSecs(base + 11 * width), buckets), 0);
+}
+
+TEST(RateMeter, StaleEventDiscarded) {
+    RateMeter meter(width, buckets, 1);
+    meter.Record(Time::FromEpochNSecs(base + 11 * width), 1);
+    // Maps to the same slot, but is older than its current data.
+    meter.Record(Time::FromEpochNSecs(base), 100);
+    ASSERT_EQ(meter.Count(Time::FromEpochNSecs(base + 12 * width), buckets), 1);
+}
+
+TEST(RateMeter, RecordNow) {
+    RateMeter meter(width, buckets);
+    Time start;
+    meter.Record();
+    meter.Record(2);
+    Time later = Time::FromEpochNSecs(start.EpochNSecs() + 2 * width);
+    ASSERT_EQ(meter.Count(later, buckets), 3);
+}
+
+TEST(RateMeter, ConcurrentWriters) {
+    const size_t threads = 8;
+    const uint32_t events = 10000;
+    RateMeter meter(width, buckets, 3);
+    std::vector<std::thread> writers;
+    for (size_t t = 0; t < threads; ++t) {
+        writers.emplace_back([&meter] () -> void {
+            for (uint32_t i = 0; i < events; ++i) {
+                meter.Record(Time::FromEpochNSecs(base + (i % 5) * width));
+            }
+        });
+    }
+    for (std::thread& writer: writers) {
+        writer.join();
+    }
+    ASSERT_EQ(meter.Count(Time::FromEpochNSecs(base + 5 * width), buckets), threads * events);
+}
@@ -0,0 +1,285 @@
+#include <gtest/gtest.h>
+#include <util_time_shared_clock.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+using namespace nstimestamp;
+
+namespace {
+    const long MS = 1000000L;
+
+    // Tolerance, between the shared clock and CLOCK_REALTIME
+    const long tolerance = 20 * MS;
+
+    std::string SegmentName(const std::string& test) {
+        return "/nstimestamp_" + test + "_" + std::to_string(getpid());
+    }
+
+    bool WithinTolerance(long sharedNs) {
+        const long realtime = Time().EpochNSecs();
+        return sharedNs > realtime - tolerance && sharedNs < realtime + tolerance;
+    }
+
+    /**
+     * Read the shared clock, bracketed by CLOCK_REALTIME (the reader may be
+     * de-scheduled at any point, whilst other processes run)
+     */
+    bool ReadWithinTolerance(const SharedClockReader& reader, long& sharedNs) {
+        const long before = Time().EpochNSecs();
+        sharedNs = reader.EpochNSecs();
+        const long after = Time().EpochNSecs();
+        return sharedNs > before - tolerance && sharedNs < after + tolerance;
+    }
+
+    /**
+     * Re-base the parameters to a different point on the same line.
+     */
+    SharedClockParams Rebase(const SharedClockParams& params, long ticks) {
+        SharedClockParams rebased = params;
+        rebased.baseCounter += ticks;
+        rebased.baseNs += static_cast<long>(
+            (static_cast<double>(ticks) * params.mult) / (1ULL << params.shift));
+        return rebased;
+    }
+
+    /**
+     * Simulate a publisher dying mid-update: seq is the segment's second word
+     */
+    bool SetSequenceOdd(const std::string& name) {
+        const int fd = shm_open(name.c_str(), O_RDWR, 0);
+        if (fd < 0) {
+            return false;
+        }
+        void* addr = mmap(nullptr, 2 * sizeof(uint64_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (addr == MAP_FAILED) {
+            return false;
+        }
+        volatile uint64_t* seq = static_cast<volatile uint64_t*>(addr) + 1;
+        *seq += 1;
+        munmap(addr, 2 * sizeof(uint64_t));
+        return true;
+    }
+
+    /**
+     * Fork count readers, each of which runs check(reader) and exits with its
+     * result. Returns the number of readers that failed.
+     */
+    template <class Check>
+    size_t ForkReaders(const std::string& name, size_t count, Check check) {
+        std::vector<pid_t> children;
+        for (size_t i = 0; i < count; ++i) {
+            const pid_t pid = fork();
+            if (pid == 0) {
+                SharedClockReader reader(name);
+                _exit(check(reader) ? 0 : 1);
+            }
+            children.push_back(pid);
+        }
+
+        size_t failures = 0;
+        for (pid_t child: children) {
+            int status = 0;
+            waitpid(child, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                ++failures;
+            }
+        }
+        return failures;
+    }
+}
+
+TEST(SharedClock, NoSegment) {
+    SharedClockReader reader(SegmentName("NoSegment"));
+    ASSERT_FALSE(reader.IsOpen());
+    ASSERT_FALSE(reader.IsPublished());
+
+    // Falls back to the system clock
+    Time now(Time::EpochTimestamp);
+    reader.SetNow(now);
+    ASSERT_TRUE(WithinTolerance(now.EpochNSecs()));
+}
+
+TEST(SharedClock, NotPublished) {
+    SharedClockPublisher publisher(SegmentName("NotPublished"));
+    ASSERT_TRUE(publisher.IsOpen());
+    SharedClockReader reader(SegmentName("NotPublished"));
+    publisher.Unlink();
+
+    ASSERT_TRUE(reader.IsOpen());
+    ASSERT_FALSE(reader.IsPublished());
+    ASSERT_TRUE(WithinTolerance(reader.EpochNSecs()));
+}
+
+TEST(SharedClock, Params) {
+    SharedClockPublisher publisher(SegmentName("Params"));
+    SharedClockReader reader(SegmentName("Params"));
+    publisher.Unlink();
+
+    SharedClockParams params;
+    params.baseCounter = 1234;
+    params.baseNs = 5678;
+    params.mult = 3ULL << 31;
+    params.shift = 32;
+    params.offsetNs = -42;
+    publisher.Publish(params);
+
+    SharedClockParams read;
+    ASSERT_TRUE(reader.Params(read));
+    ASSERT_EQ(read.baseCounter, params.baseCounter);
+    ASSERT_EQ(read.baseNs, params.baseNs);
+    ASSERT_EQ(read.mult, params.mult);
+    ASSERT_EQ(read.shift, params.shift);
+    ASSERT_EQ(read.offsetNs, params.offsetNs);
+}
+
+TEST(SharedClock, Calibrated) {
+    SharedClockPublisher publisher(SegmentName("Calibrated"));
+    SharedClockReader reader(SegmentName("Calibrated"));
+    publisher.Unlink();
+
+    publisher.Publish(SharedClockPublisher::Calibrate(10 * MS));
+    ASSERT_TRUE(reader.IsPublished());
+
+    Time now(Time::EpochTimestamp);
+    reader.SetNow(now);
+    ASSERT_TRUE(WithinTolerance(now.EpochNSecs()));
+}
+
+TEST(SharedClock, Offset) {
+    SharedClockPublisher publisher(SegmentName("Offset"));
+    SharedClockReader reader(SegmentName("Offset"));
+    publisher.Unlink();
+
+    publisher.Publish(SharedClockPublisher::Calibrate(10 * MS, 3600 * 1000 * MS));
+    const long shifted = reader.EpochNSecs() - 3600 * 1000 * MS;
+    ASSERT_TRUE(WithinTolerance(shifted));
+}
+
+TEST(SharedClock, MultiProcess) {
+    const std::string name = SegmentName("MultiProcess");
+    SharedClockPublisher publisher(name);
+    publisher.Publish(SharedClockPublisher::Calibrate(10 * MS));
+
+    const size_t failures = ForkReaders(name, 4, [] (const SharedClockReader& reader) -> bool {
+        if (!reader.IsPublished()) {
+            return false;
+        }
+        long last = 0;
+        for (size_t i = 0; i < 100000; ++i) {
+            long now = 0;
+            if (!ReadWithinTolerance(reader, now) || now < last) {
+                return false;
+            }
+            last = now;
+        }
+        return true;
+    });
+    publisher.Unlink();
+
+    ASSERT_EQ(failures, 0);
+}
+
+/**
+ * Continually republish (alternating between two, widely separated, points on
+ * the same line) whilst other processes are reading. Any torn read would mix
+ * the two bases, and produce a time seconds away from the truth.
+ */
+TEST(SharedClock, MultiProcessTornReads) {
+    const std::string name = SegmentName("MultiProcessTornReads");
+    SharedClockPublisher publisher(name);
+    const SharedClockParams calibration = SharedClockPublisher::Calibrate(10 * MS);
+    const SharedClockParams rebased = Rebase(calibration, -10000000000L);
+    publisher.Publish(calibration);
+
+    const pid_t writer = fork();
+    if (writer == 0) {
+        for (size_t i = 0; i < 1000000; ++i) {
+            publisher.Publish((i % 2) ? calibration : rebased);
+        }
+        _exit(0);
+    }
+
+    const size_t failures = ForkReaders(name, 3, [] (const SharedClockReader& reader) -> bool {
+        long now = 0;
+        for (size_t i = 0; i < 100000; ++i) {
+            if (!ReadWithinTolerance(reader, now)) {
+                return false;
+            }
+        }
+        return true;
+    });
+    waitpid(writer, nullptr, 0);
+    publisher.Unlink();
+
+    ASSERT_EQ(failures, 0);
+}
+
+/**
+ * A reader which has already read the parameters stays on the (offset)
+ * shared clock whilst an update is stuck, rather than jumping back to the
+ * system clock
+ */
+TEST(SharedClock, StuckUpdateKeepsLastParams) {
+    const std::string name = SegmentName("StuckUpdateKeepsLastParams");
+    SharedClockPublisher publisher(name);
+    SharedClockReader reader(name);
+    publisher.Publish(SharedClockPublisher::Calibrate(10 * MS, 3600 * 1000 * MS));
+    ASSERT_TRUE(reader.IsPublished());
+
+    ASSERT_TRUE(SetSequenceOdd(name));
+    publisher.Unlink();
+    ASSERT_FALSE(reader.IsPublished());
+    ASSERT_TRUE(WithinTolerance(reader.EpochNSecs() - 3600 * 1000 * MS));
+}
+
+/**
+ * A publisher which dies mid-update leaves the sequence odd: readers must
+ * fall back to the system clock (rather than spin), and a new publisher
+ * must be able to recover the segment.
+ */
+TEST(SharedClock, CrashedPublisher) {
+    const std::string name = SegmentName("CrashedPublisher");
+    {
+        SharedClockPublisher publisher(name);
+        publisher.Publish(SharedClockPublisher::Calibrate(10 * MS));
+    }
+
+    ASSERT_TRUE(SetSequenceOdd(name));
+
+    // Readers are run in a child, so that a hang fails the test
+    auto fallsBack = [] (const SharedClockReader& reader) -> bool {
+        alarm(10);
+        long now = 0;
+        return !reader.IsPublished() && ReadWithinTolerance(reader, now);
+    };
+    ASSERT_EQ(ForkReaders(name, 1, fallsBack), 0);
+
+    // A restarted publisher recovers the segment...
+    SharedClockPublisher publisher(name);
+    ASSERT_EQ(ForkReaders(name, 1, fallsBack), 0);
+
+    // ...once it has published
+    SharedClockParams params = SharedClockPublisher::Calibrate(10 * MS);
+    params.offsetNs = 3600 * 1000 * MS;
+    const pid_t child = fork();
+    if (child == 0) {
+        alarm(10);
+        publisher.Publish(params);
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    const size_t failures = ForkReaders(name, 1, [] (const SharedClockReader& reader) -> bool {
+        alarm(10);
+        return reader.IsPublished() && WithinTolerance(reader.EpochNSecs() - 3600 * 1000 * MS);
+    });
+    publisher.Unlink();
+    ASSERT_EQ(failures, 0);
+}
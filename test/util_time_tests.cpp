@@ -117,6 +117,13 @@ TEST(Timestamps,InvalidTimestamps) {
     AssertIsEpoch("2017");
 }
 
+TEST(Timestamps,FromEpochNSecs) {
+    const Time timestamp = Time::FromEpochNSecs(Time(reftime).EpochNSecs());
+    AssertTimeMatches(timestamp);
+    ASSERT_EQ(Time::FromEpochNSecs(0).Timestamp(), Time::EpochTimestamp);
+    ASSERT_EQ(Time::FromEpochNSecs(-1).Timestamp(), "19691231 23:59:59.999999999");
+}
+
 TEST(Timestamps,Copy) {
     Time timestamp(reftime);
     Time copy(timestamp);
@@ -128,9 +135,9 @@ TEST(DiffSeconds,NoDiff) {
 }
 
 TEST(DiffSeconds,YearDiff) {
-    // TODO: Leap second handling...
     // TODO: Sub-second diff (microseconds etc)
-    // TODO: 2016 was a leap year, and there was an additional leapSecond inserted on the 31st of Dec of 2016
+    // NOTE: 2016 was a leap year. Leap seconds (30th June 2015, 31st Dec 2016)
+    //       are ignored here, as by POSIX: see LeapSeconds.Diffs
     long threeYears = ((3 * 365 + 1) * 24 * 60 * 60);
     long diff = Time("20170403 10:11:02.194930").DiffSecs("20140403 10:11:02.194930");
     ASSERT_EQ(diff, threeYears);
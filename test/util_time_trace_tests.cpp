@@ -0,0 +1,252 @@
+#include <gtest/gtest.h>
+#include <util_time_trace.h>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+using namespace nstimestamp;
+
+namespace {
+    struct DecodedSpan {
+        int64_t     start;
+        int64_t     duration;
+        std::string name;
+        uint32_t    tid;
+        uint32_t    depth;
+    };
+
+    template <class T>
+    T Read(std::istream& is) {
+        T value;
+        is.read(reinterpret_cast<char*>(&value), sizeof(value));
+        return value;
+    }
+
+    std::vector<DecodedSpan> Decode(const std::string& binary) {
+        std::istringstream is(binary);
+        char magic[8];
+        is.read(magic, sizeof(magic));
+        EXPECT_EQ(std::string(magic, 8), "NSTTRC02");
+
+        std::vector<std::string> names(Read<uint32_t>(is));
+        for (std::string& name: names) {
+            name.resize(Read<uint32_t>(is));
+            is.read(&name[0], name.size());
+        }
+
+        std::vector<DecodedSpan> spans(Read<uint64_t>(is));
+        for (DecodedSpan& span: spans) {
+            span.start = Read<int64_t>(is);
+            span.duration = Read<int64_t>(is);
+            span.name = names.at(Read<uint32_t>(is));
+            span.tid = Read<uint32_t>(is);
+            span.depth = Read<uint32_t>(is);
+        }
+        EXPECT_TRUE(is.good());
+        EXPECT_EQ(is.peek(), EOF);
+        return spans;
+    }
+
+    std::vector<DecodedSpan> Capture() {
+        std::ostringstream os;
+        Trace::WriteBinary(os);
+        return Decode(os.str());
+    }
+}
+
+TEST(Trace, Empty) {
+    Trace::Clear();
+    ASSERT_EQ(Trace::Spans(), 0);
+    ASSERT_EQ(Capture().size(), 0);
+
+    std::ostringstream os;
+    Trace::WriteChromeJSON(os);
+    ASSERT_EQ(os.str(), "{\"traceEvents\":[\n],\"displayTimeUnit\":\"ns\""
+                        ",\"otherData\":{\"baseNs\":\"0\"}}\n");
+}
+
+TEST(Trace, Nested) {
+    Trace::Clear();
+    const long before = Time().EpochNSecs();
+    {
+        TraceSpan outer("outer");
+        {
+            TraceSpan inner("inner");
+        }
+        TraceSpan second("second");
+    }
+    const long after = Time().EpochNSecs();
+
+    const std::vector<DecodedSpan> spans = Capture();
+    ASSERT_EQ(spans.size(), 3);
+    ASSERT_EQ(spans[0].name, "outer");
+    ASSERT_EQ(spans[0].depth, 0);
+    ASSERT_EQ(spans[1].name, "inner");
+    ASSERT_EQ(spans[1].depth, 1);
+    ASSERT_EQ(spans[2].name, "second");
+    ASSERT_EQ(spans[2].depth, 1);
+
+    for (const DecodedSpan& span: spans) {
+        ASSERT_EQ(span.tid, spans[0].tid);
+        ASSERT_GE(span.start, before);
+        ASSERT_GE(span.duration, 0);
+        ASSERT_LE(span.start + span.duration, after);
+    }
+
+    // Children are contained by their parent
+    for (size_t i: {1, 2}) {
+        ASSERT_GE(spans[i].start, spans[0].start);
+        ASSERT_LE(spans[i].start + spans[i].duration,
+                  spans[0].start + spans[0].duration);
+    }
+}
+
+TEST(Trace, Record) {
+    Trace::Clear();
+    const Time start("20140403 10:11:02.294930000");
+    const Time end("20140403 10:11:02.294931500");
+    Trace::Record("top", start, end);
+    {
+        TraceSpan outer("outer");
+        Trace::Record("child", start, end);
+    }
+
+    const std::vector<DecodedSpan> spans = Capture();
+    ASSERT_EQ(spans.size(), 3);
+    ASSERT_EQ(spans[0].name, "top");
+    ASSERT_EQ(spans[0].start, start.EpochNSecs());
+    ASSERT_EQ(spans[0].duration, 1500);
+    ASSERT_EQ(spans[0].depth, 0);
+    ASSERT_EQ(spans[1].name, "outer");
+    ASSERT_EQ(spans[1].depth, 0);
+    ASSERT_EQ(spans[2].name, "child");
+    ASSERT_EQ(spans[2].depth, 1);
+}
+
+TEST(Trace, OpenSpansAreNotExported) {
+    Trace::Clear();
+    Trace::Begin("open");
+    Trace::Begin("closed");
+    Trace::End();
+    ASSERT_EQ(Trace::Spans(), 2);
+
+    const std::vector<DecodedSpan> spans = Capture();
+    ASSERT_EQ(spans.size(), 1);
+    ASSERT_EQ(spans[0].name, "closed");
+    ASSERT_EQ(spans[0].depth, 1);
+
+    std::ostringstream os;
+    Trace::WriteChromeJSON(os);
+    ASSERT_EQ(os.str().find("\"open\""), std::string::npos);
+
+    Trace::End();
+    ASSERT_EQ(Capture().size(), 2);
+}
+
+TEST(Trace, UnmatchedEnd) {
+    Trace::Clear();
+    Trace::End();
+    ASSERT_EQ(Trace::Spans(), 0);
+    ASSERT_EQ(Capture().size(), 0);
+}
+
+TEST(Trace, Threads) {
+    Trace::Clear();
+    const size_t spansPerThread = 10000;
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 4; ++t) {
+        threads.emplace_back([=] () -> void {
+            for (size_t i = 0; i < spansPerThread; ++i) {
+                TraceSpan span("work");
+            }
+        });
+    }
+    for (std::thread& thread: threads) {
+        thread.join();
+    }
+    ASSERT_EQ(Trace::Spans(), 4 * spansPerThread);
+
+    std::map<uint32_t, size_t> perThread;
+    for (const DecodedSpan& span: Capture()) {
+        ASSERT_EQ(span.name, "work");
+        ASSERT_EQ(span.depth, 0);
+        ++perThread[span.tid];
+    }
+    ASSERT_EQ(perThread.size(), 4);
+    for (const auto& thread: perThread) {
+        ASSERT_EQ(thread.second, spansPerThread);
+    }
+
+    Trace::Clear();
+    ASSERT_EQ(Trace::Spans(), 0);
+}
+
+/**
+ * Exited threads' spans are exported, but their buffers are freed by Clear()
+ */
+TEST(Trace, ExitedThreads) {
+    Trace::Clear();
+    const size_t live = Trace::Buffers();
+    for (size_t t = 0; t < 100; ++t) {
+        std::thread([] () -> void {
+            TraceSpan span("exited");
+        }).join();
+    }
+    ASSERT_EQ(Trace::Buffers(), live + 100);
+    ASSERT_EQ(Capture().size(), 100);
+
+    Trace::Clear();
+    ASSERT_EQ(Trace::Buffers(), live);
+    ASSERT_EQ(Trace::Spans(), 0);
+}
+
+TEST(Trace, ChromeJSON) {
+    Trace::Clear();
+    {
+        TraceSpan span("quote\"d");
+    }
+    const DecodedSpan span = Capture().at(0);
+
+    std::ostringstream os;
+    Trace::WriteChromeJSON(os);
+
+    std::ostringstream expected;
+    expected << "{\"traceEvents\":[\n"
+             << "{\"name\":\"quote\\\"d\",\"ph\":\"X\""
+             << ",\"ts\":0.000"
+             << ",\"dur\":" << span.duration / 1000 << "." << std::setfill('0') << std::setw(3) << span.duration % 1000
+             << ",\"pid\":" << getpid()
+             << ",\"tid\":" << span.tid
+             << "}\n],\"displayTimeUnit\":\"ns\""
+             << ",\"otherData\":{\"baseNs\":\"" << span.start << "\"}}\n";
+    ASSERT_EQ(os.str(), expected.str());
+}
+
+/**
+ * ts is relative to the earliest span (which need not be the first
+ * recorded), so that ns precision survives the viewer's double
+ */
+TEST(Trace, ChromeJSONRelative) {
+    Trace::Clear();
+    const Time early("20140403 10:11:02.294930001");
+    const Time late("20140403 10:11:02.294931502");
+    Trace::Record("late", late, Time("20140403 10:11:02.294932503"));
+    Trace::Record("early", early, late);
+    const uint32_t tid = Capture().at(0).tid;
+
+    std::ostringstream os;
+    Trace::WriteChromeJSON(os);
+
+    std::ostringstream expected;
+    expected << "{\"traceEvents\":[\n"
+             << "{\"name\":\"late\",\"ph\":\"X\",\"ts\":1.501,\"dur\":1.001"
+             << ",\"pid\":" << getpid() << ",\"tid\":" << tid << "},\n"
+             << "{\"name\":\"early\",\"ph\":\"X\",\"ts\":0.000,\"dur\":1.501"
+             << ",\"pid\":" << getpid() << ",\"tid\":" << tid << "}\n"
+             << "],\"displayTimeUnit\":\"ns\""
+             << ",\"otherData\":{\"baseNs\":\"" << early.EpochNSecs() << "\"}}\n";
+    ASSERT_EQ(os.str(), expected.str());
+}
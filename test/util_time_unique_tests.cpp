@@ -0,0 +1,171 @@
+#include <gtest/gtest.h>
+#include <util_time_unique.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace nstimestamp;
+
+namespace {
+    const size_t numThreads = 8;
+    const size_t numIds = 20000;
+
+    /**
+     * Generate numIds ids on each of numThreads threads.
+     */
+    std::vector<std::vector<long>> GenerateConcurrently(UniqueTimeGenerator& gen) {
+        std::vector<std::vector<long>> ids(numThreads);
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < numThreads; ++t) {
+            std::vector<long>& threadIds = ids[t];
+            threads.emplace_back([&gen, &threadIds] () -> void {
+                threadIds.reserve(numIds);
+                for (size_t i = 0; i < numIds; ++i) {
+                    threadIds.push_back(gen.NextNSecs());
+                }
+            });
+        }
+        for (std::thread& thread: threads) {
+            thread.join();
+        }
+        return ids;
+    }
+
+    void AssertIncreasing(const std::vector<long>& ids) {
+        for (size_t i = 1; i < ids.size(); ++i) {
+            ASSERT_LT(ids[i-1], ids[i]);
+        }
+    }
+
+    void AssertUnique(const std::vector<std::vector<long>>& ids) {
+        std::vector<long> all;
+        for (const std::vector<long>& threadIds: ids) {
+            all.insert(all.end(), threadIds.begin(), threadIds.end());
+        }
+        std::sort(all.begin(), all.end());
+        ASSERT_EQ(std::adjacent_find(all.begin(), all.end()), all.end());
+    }
+}
+
+TEST(UniqueTime, StrictlyIncreasing) {
+    UniqueTimeGenerator gen;
+    std::vector<long> ids;
+    for (size_t i = 0; i < numIds; ++i) {
+        ids.push_back(gen.NextNSecs());
+    }
+    AssertIncreasing(ids);
+}
+
+TEST(UniqueTime, TracksClock) {
+    UniqueTimeGenerator gen;
+    Time before;
+    Time id = gen.Next();
+    Time after;
+    ASSERT_GE(id.DiffNSecs(before), 0);
+    ASSERT_LE(id.DiffNSecs(after), 0);
+}
+
+TEST(UniqueTime, NextTime) {
+    UniqueTimeGenerator gen;
+    Time first(Time::EpochTimestamp);
+    Time second(Time::EpochTimestamp);
+    gen.Next(first);
+    gen.Next(second);
+    ASSERT_GT(second.DiffNSecs(first), 0);
+}
+
+TEST(UniqueTime, StrictConcurrent) {
+    UniqueTimeGenerator gen;
+    const std::vector<std::vector<long>> ids = GenerateConcurrently(gen);
+    for (const std::vector<long>& threadIds: ids) {
+        AssertIncreasing(threadIds);
+    }
+    AssertUnique(ids);
+}
+
+TEST(UniqueTime, BatchedStrictlyIncreasing) {
+    UniqueTimeGenerator gen(64);
+    ASSERT_EQ(gen.BatchSize(), 64);
+    std::vector<long> ids;
+    for (size_t i = 0; i < numIds; ++i) {
+        ids.push_back(gen.NextNSecs());
+    }
+    AssertIncreasing(ids);
+}
+
+TEST(UniqueTime, BatchedTracksClock) {
+    const long batch = 1000;
+    UniqueTimeGenerator gen(batch);
+    for (size_t i = 0; i < 1000; ++i) {
+        Time before;
+        const long id = gen.NextNSecs();
+        Time after;
+        ASSERT_GE(id, before.EpochNSecs() - batch);
+        ASSERT_LE(id, after.EpochNSecs() + batch);
+    }
+}
+
+TEST(UniqueTime, BatchedConcurrent) {
+    UniqueTimeGenerator gen(64);
+    const std::vector<std::vector<long>> ids = GenerateConcurrently(gen);
+    for (const std::vector<long>& threadIds: ids) {
+        AssertIncreasing(threadIds);
+    }
+    AssertUnique(ids);
+}
+
+TEST(UniqueTime, InterleavedGenerators) {
+    UniqueTimeGenerator first(64);
+    UniqueTimeGenerator second(64);
+    std::vector<long> firstIds, secondIds;
+    for (size_t i = 0; i < numIds; ++i) {
+        firstIds.push_back(first.NextNSecs());
+        secondIds.push_back(second.NextNSecs());
+    }
+    AssertIncreasing(firstIds);
+    AssertIncreasing(secondIds);
+}
+
+/**
+ * Alternating between generators must not discard (and re-reserve) a batch
+ * on every call, running ahead of the clock
+ */
+TEST(UniqueTime, InterleavedGeneratorsTrackClock) {
+    const long batch = 4096;
+    UniqueTimeGenerator first(batch);
+    UniqueTimeGenerator second(batch);
+    for (size_t i = 0; i < 200000; ++i) {
+        const long firstId = first.NextNSecs();
+        const long secondId = second.NextNSecs();
+        const long now = Time().EpochNSecs();
+        ASSERT_LE(firstId, now + batch);
+        ASSERT_LE(secondId, now + batch);
+    }
+}
+
+/**
+ * Threads reserving batches within the same few nano-seconds must not push
+ * the shared value ahead of the clock
+ */
+TEST(UniqueTime, BatchedConcurrentTracksClock) {
+    const long batch = 4096;
+    UniqueTimeGenerator gen(batch);
+    std::vector<std::thread> threads;
+    std::atomic<size_t> ahead(0);
+    for (size_t t = 0; t < numThreads; ++t) {
+        threads.emplace_back([&gen, &ahead, batch] () -> void {
+            for (size_t i = 0; i < numIds; ++i) {
+                const long id = gen.NextNSecs();
+                if (id > Time().EpochNSecs() + batch) {
+                    ++ahead;
+                }
+            }
+        });
+    }
+    for (std::thread& thread: threads) {
+        thread.join();
+    }
+    ASSERT_EQ(ahead, 0);
+}